@@ -51,6 +51,7 @@ LinkerDriver *Driver;
 BumpPtrAllocator BAlloc;
 StringSaver Saver{BAlloc};
 std::vector<SpecificAllocBase *> SpecificAllocBase::Instances;
+std::mutex SpecificAllocBase::Mu;
 
 bool link(ArrayRef<const char *> Args, raw_ostream &Diag) {
   ErrorCount = 0;
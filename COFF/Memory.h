@@ -15,7 +15,9 @@
 #define LLD_COFF_MEMORY_H
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/StringSaver.h"
+#include <mutex>
 #include <vector>
 
 namespace lld {
@@ -25,10 +27,14 @@ extern llvm::BumpPtrAllocator BAlloc;
 extern llvm::StringSaver Saver;
 
 struct SpecificAllocBase {
-  SpecificAllocBase() { Instances.push_back(this); }
+  SpecificAllocBase() {
+    std::lock_guard<std::mutex> Lock(Mu);
+    Instances.push_back(this);
+  }
   virtual ~SpecificAllocBase() = default;
   virtual void reset() = 0;
   static std::vector<SpecificAllocBase *> Instances;
+  static std::mutex Mu;
 };
 
 template <class T> struct SpecificAlloc : public SpecificAllocBase {
@@ -37,8 +43,10 @@ template <class T> struct SpecificAlloc : public SpecificAllocBase {
 };
 
 template <typename T, typename... U> T *make(U &&... Args) {
-  static SpecificAlloc<T> Alloc;
-  return new (Alloc.Alloc.Allocate()) T(std::forward<U>(Args)...);
+  static LLVM_THREAD_LOCAL SpecificAlloc<T> *Alloc = nullptr;
+  if (!Alloc)
+    Alloc = new SpecificAlloc<T>;
+  return new (Alloc->Alloc.Allocate()) T(std::forward<U>(Args)...);
 }
 
 inline void freeArena() {
@@ -7,6 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "Config.h"
 #include "Error.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
@@ -40,6 +41,9 @@ public:
   void writePlt(uint8_t *Buf, uint64_t GotPltEntryAddr, uint64_t PltEntryAddr,
                 int32_t Index, unsigned RelOff) const override;
   bool usesOnlyLowPageBits(uint32_t Type) const override;
+  bool needsThunk(RelExpr Expr, uint32_t Type, const InputFile *File,
+                  uint64_t BranchAddr, const SymbolBody &S) const override;
+  bool inBranchRange(uint32_t Type, uint64_t Src, uint64_t Dst) const override;
   void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const override;
   RelExpr adjustRelaxExpr(uint32_t Type, const uint8_t *Data,
                           RelExpr Expr) const override;
@@ -63,6 +67,11 @@ AArch64::AArch64() {
   PltHeaderSize = 32;
   DefaultMaxPageSize = 65536;
 
+  // The B and BL instructions have a range of +/- 128 MiB. Calls that
+  // don't reach their destination go through range extension thunks.
+  NeedsThunks = true;
+  ThunkSectionSpacing = (128 * 1024 * 1024) - 0x30000;
+
   // It doesn't seem to be documented anywhere, but tls on aarch64 uses variant
   // 1 of the tls structures and the tcb size is 16.
   TcbSize = 16;
@@ -106,6 +115,31 @@ RelExpr AArch64::getRelExpr(uint32_t Type, const SymbolBody &S,
   }
 }
 
+bool AArch64::needsThunk(RelExpr Expr, uint32_t Type, const InputFile *File,
+                         uint64_t BranchAddr, const SymbolBody &S) const {
+  // ELF for the ARM 64-bit architecture permits the linker to use range
+  // extension thunks only for R_AARCH64_CALL26 and R_AARCH64_JUMP26.
+  if (Type != R_AARCH64_CALL26 && Type != R_AARCH64_JUMP26)
+    return false;
+  // A branch to an undefined weak symbol in an executable is resolved to
+  // the next instruction, so it doesn't need a Thunk.
+  if (S.isUndefined() && !S.isLocal() && S.symbol()->isWeak() &&
+      !Config->Shared)
+    return false;
+  uint64_t Dst = (Expr == R_PLT_PC) ? S.getPltVA() : S.getVA();
+  return !inBranchRange(Type, BranchAddr, Dst);
+}
+
+bool AArch64::inBranchRange(uint32_t Type, uint64_t Src, uint64_t Dst) const {
+  if (Type != R_AARCH64_CALL26 && Type != R_AARCH64_JUMP26)
+    return true;
+  // The immediate of the branch is a signed 26-bit word offset.
+  uint64_t Range = 128 * 1024 * 1024;
+  if (Dst > Src)
+    return Dst - Src <= Range - 4;
+  return Src - Dst <= Range;
+}
+
 RelExpr AArch64::adjustRelaxExpr(uint32_t Type, const uint8_t *Data,
                                  RelExpr Expr) const {
   if (Expr == R_RELAX_TLS_GD_TO_IE) {
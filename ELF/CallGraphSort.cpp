@@ -0,0 +1,208 @@
+//===- CallGraphSort.cpp --------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements section ordering based on a call graph profile,
+// which is a list of (caller section, callee section, call count) tuples.
+// It is given by --call-graph-ordering-file or .llvm.call-graph-profile
+// sections in input files.
+//
+// The algorithm is Call-Chain Clustering (C3) described in [1]. It tries
+// to place functions that call each other frequently close together,
+// so that hot code shares fewer pages and thus fewer iTLB entries.
+//
+//  1. Each input section starts as a cluster of its own. Its weight is the
+//     sum of the counts of the calls to it, and its density is its weight
+//     divided by its size.
+//
+//  2. Clusters are visited in decreasing order of density. A cluster is
+//     appended to the cluster containing its most likely caller, unless
+//     the combined cluster would be too large or much less dense.
+//
+//  3. The resulting clusters are sorted by density, and sections are laid
+//     out in that order.
+//
+// [1] Guilherme Ottoni and Bertrand Maher. Optimizing Function Placement
+//     for Large-Scale Data-Center Applications. CGO 2017.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallGraphSort.h"
+#include "Config.h"
+#include "InputSection.h"
+#include "OutputSections.h"
+
+#include <algorithm>
+
+using namespace llvm;
+using namespace lld;
+using namespace lld::elf;
+
+namespace {
+struct Edge {
+  int From;
+  uint64_t Weight;
+};
+
+struct Cluster {
+  Cluster(int Sec, size_t Size) : Sections{Sec}, Size(Size) {}
+
+  double getDensity() const {
+    if (Size == 0)
+      return 0;
+    return double(Weight) / double(Size);
+  }
+
+  std::vector<int> Sections;
+  size_t Size = 0;
+  uint64_t Weight = 0;
+  uint64_t InitialWeight = 0;
+  Edge BestPred = {-1, 0};
+};
+
+class CallGraphSort {
+public:
+  CallGraphSort();
+  DenseMap<const InputSectionBase *, int> run();
+
+private:
+  void groupClusters();
+
+  std::vector<Cluster> Clusters;
+  std::vector<const InputSectionBase *> Sections;
+};
+} // namespace
+
+// Clusters are not merged if their density would drop below 1/8 of the
+// density of the cluster being appended to.
+static const int MaxDensityDegradation = 8;
+
+// Clusters are not merged if the result would exceed this size.
+static const uint64_t MaxClusterSize = 1024 * 1024;
+
+// Builds a graph whose nodes are sections and whose edges are calls.
+// Edges between sections in different output sections are ignored
+// because they cannot be placed next to each other anyway.
+CallGraphSort::CallGraphSort() {
+  DenseMap<const InputSectionBase *, int> SecToCluster;
+
+  auto GetOrCreateNode = [&](const InputSectionBase *IS) -> int {
+    auto Res = SecToCluster.insert({IS, Clusters.size()});
+    if (Res.second) {
+      Sections.push_back(IS);
+      Clusters.emplace_back(Clusters.size(), IS->getSize());
+    }
+    return Res.first->second;
+  };
+
+  for (auto &P : Config->CallGraphProfile) {
+    const InputSectionBase *FromSec = P.first.first->Repl;
+    const InputSectionBase *ToSec = P.first.second->Repl;
+    uint64_t Weight = P.second;
+
+    if (!FromSec->Live || !ToSec->Live)
+      continue;
+    if (FromSec->getOutputSection() != ToSec->getOutputSection())
+      continue;
+
+    int From = GetOrCreateNode(FromSec);
+    int To = GetOrCreateNode(ToSec);
+    Clusters[To].Weight += Weight;
+    if (From == To)
+      continue;
+
+    // Remember the most likely caller.
+    Edge &Best = Clusters[To].BestPred;
+    if (Best.From == -1 || Best.Weight < Weight)
+      Best = {From, Weight};
+  }
+
+  for (Cluster &C : Clusters)
+    C.InitialWeight = C.Weight;
+}
+
+// Returns true if merging B into A would make A much less dense.
+static bool isNewDensityBad(Cluster &A, Cluster &B) {
+  double NewDensity = double(A.Weight + B.Weight) / double(A.Size + B.Size);
+  return NewDensity < A.getDensity() / MaxDensityDegradation;
+}
+
+static void mergeClusters(Cluster &Into, Cluster &From) {
+  Into.Sections.insert(Into.Sections.end(), From.Sections.begin(),
+                       From.Sections.end());
+  Into.Size += From.Size;
+  Into.Weight += From.Weight;
+  From.Sections.clear();
+  From.Size = 0;
+  From.Weight = 0;
+}
+
+void CallGraphSort::groupClusters() {
+  std::vector<int> SortedSecs(Clusters.size());
+  std::vector<Cluster *> SecToCluster(Clusters.size());
+  for (size_t I = 0, E = Clusters.size(); I != E; ++I) {
+    SortedSecs[I] = I;
+    SecToCluster[I] = &Clusters[I];
+  }
+
+  std::stable_sort(SortedSecs.begin(), SortedSecs.end(), [&](int A, int B) {
+    return Clusters[A].getDensity() > Clusters[B].getDensity();
+  });
+
+  for (int SI : SortedSecs) {
+    // Clusters[SI] still contains section SI because a cluster is only
+    // merged away when its own section is visited.
+    Cluster &C = Clusters[SI];
+
+    // Don't merge if the edge is unlikely, i.e. if the best caller makes
+    // at most 10% of the calls.
+    if (C.BestPred.From == -1 || C.BestPred.Weight * 10 <= C.InitialWeight)
+      continue;
+
+    Cluster *PredC = SecToCluster[C.BestPred.From];
+    if (PredC == &C)
+      continue;
+    if (C.Size + PredC->Size > MaxClusterSize)
+      continue;
+    if (isNewDensityBad(*PredC, C))
+      continue;
+
+    for (int I : C.Sections)
+      SecToCluster[I] = PredC;
+    mergeClusters(*PredC, C);
+  }
+
+  // Remove clusters that have been merged into others and sort the rest
+  // by density.
+  Clusters.erase(std::remove_if(Clusters.begin(), Clusters.end(),
+                                [](const Cluster &C) {
+                                  return C.Sections.empty();
+                                }),
+                 Clusters.end());
+  std::stable_sort(Clusters.begin(), Clusters.end(),
+                   [](const Cluster &A, const Cluster &B) {
+                     return A.getDensity() > B.getDensity();
+                   });
+}
+
+// Returns section priorities. As with --symbol-ordering-file, ordered
+// sections get negative priorities so that they precede all the others.
+DenseMap<const InputSectionBase *, int> CallGraphSort::run() {
+  groupClusters();
+
+  DenseMap<const InputSectionBase *, int> OrderMap;
+  int Priority = -Sections.size();
+  for (const Cluster &C : Clusters)
+    for (int I : C.Sections)
+      OrderMap[Sections[I]] = Priority++;
+  return OrderMap;
+}
+
+DenseMap<const InputSectionBase *, int> elf::computeCallGraphProfileOrder() {
+  return CallGraphSort().run();
+}
@@ -24,6 +24,7 @@ namespace lld {
 namespace elf {
 
 class InputFile;
+class InputSectionBase;
 struct Symbol;
 
 enum ELFKind {
@@ -37,6 +38,9 @@ enum ELFKind {
 // For --build-id.
 enum class BuildIdKind { None, Fast, Md5, Sha1, Hexstring, Uuid };
 
+// For --icf-data.
+enum class ICFDataPolicy { None, Safe, All };
+
 // For --discard-{all,locals,none}.
 enum class DiscardPolicy { Default, All, Locals, None };
 
@@ -95,6 +99,7 @@ struct Configuration {
   llvm::StringRef SoName;
   llvm::StringRef Sysroot;
   llvm::StringRef ThinLTOCacheDir;
+  llvm::StringRef TimeTraceFile;
   std::string Rpath;
   std::vector<VersionDefinition> VersionDefinitions;
   std::vector<llvm::StringRef> AuxiliaryList;
@@ -105,12 +110,17 @@ struct Configuration {
   std::vector<SymbolVersion> VersionScriptLocals;
   std::vector<uint8_t> BuildIdVector;
   llvm::MapVector<Symbol *, RenamedSymbol> RenamedSymbols;
+  llvm::MapVector<std::pair<const InputSectionBase *, const InputSectionBase *>,
+                  uint64_t>
+      CallGraphProfile;
   bool AllowMultipleDefinition;
   bool AsNeeded = false;
   bool Bsymbolic;
   bool BsymbolicFunctions;
+  bool CallGraphProfileSort;
   bool ColorDiagnostics = false;
   bool CompressDebugSections;
+  bool DebugNames;
   bool DefineCommon;
   bool Demangle = true;
   bool DisableVerify;
@@ -124,6 +134,7 @@ struct Configuration {
   bool GnuHash;
   bool ICF;
   bool MipsN32Abi = false;
+  bool MmapOutputFile;
   bool NoGnuUnique;
   bool NoUndefinedVersion;
   bool Nostdlib;
@@ -133,10 +144,12 @@ struct Configuration {
   bool Pie;
   bool PrintGcSections;
   bool Relocatable;
+  bool RelrPackDynRelocs;
   bool SaveTemps;
   bool SingleRoRx;
   bool Shared;
   bool Static = false;
+  bool Stats;
   bool SysvHash;
   bool Target1Rel;
   bool Threads;
@@ -157,6 +170,7 @@ struct Configuration {
   bool ExitEarly;
   bool ZWxneeded;
   DiscardPolicy Discard;
+  ICFDataPolicy ICFData;
   SortSectionPolicy SortSection;
   StripPolicy Strip;
   UnresolvedPolicy UnresolvedSymbols;
@@ -169,6 +183,7 @@ struct Configuration {
   uint64_t ImageBase;
   uint64_t MaxPageSize;
   uint64_t ZStackSize;
+  unsigned CompressDebugSectionsLevel;
   unsigned LTOPartitions;
   unsigned LTOO;
   unsigned Optimize;
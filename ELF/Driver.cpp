@@ -39,6 +39,7 @@
 #include "SyntheticSections.h"
 #include "Target.h"
 #include "Threads.h"
+#include "Timer.h"
 #include "Writer.h"
 #include "lld/Config/Version.h"
 #include "lld/Driver/Driver.h"
@@ -56,6 +57,7 @@
 using namespace llvm;
 using namespace llvm::ELF;
 using namespace llvm::object;
+using namespace llvm::support::endian;
 using namespace llvm::sys;
 
 using namespace lld;
@@ -64,12 +66,17 @@ using namespace lld::elf;
 Configuration *elf::Config;
 LinkerDriver *elf::Driver;
 
-BumpPtrAllocator elf::BAlloc;
-StringSaver elf::Saver{BAlloc};
+ThreadSafeAllocator elf::BAlloc;
+ThreadSafeSaver elf::Saver;
 std::vector<SpecificAllocBase *> elf::SpecificAllocBase::Instances;
+std::mutex elf::SpecificAllocBase::Mu;
 
 static void setConfigs();
 
+static Timer LoadTimer("Load input files", Timer::root());
+static Timer SymbolResolutionTimer("Symbol resolution", Timer::root());
+static Timer LTOTimer("LTO", SymbolResolutionTimer);
+
 bool elf::link(ArrayRef<const char *> Args, bool CanExitEarly,
                raw_ostream &Error) {
   ErrorCount = 0;
@@ -261,15 +268,20 @@ static void checkOptions(opt::InputArgList &Args) {
   if (!Config->Shared && !Config->AuxiliaryList.empty())
     error("-f may not be used without -shared");
 
+  if (Config->CompressDebugSectionsLevel > 9)
+    error("--compress-debug-sections-level: level must be between 0 and 9");
+
   if (Config->Relocatable) {
     if (Config->Shared)
       error("-r and -shared may not be used together");
     if (Config->GcSections)
       error("-r and --gc-sections may not be used together");
-    if (Config->ICF)
+    if (Config->ICF || Config->ICFData != ICFDataPolicy::None)
       error("-r and --icf may not be used together");
     if (Config->Pie)
       error("-r and -pie may not be used together");
+    if (Config->DebugNames)
+      error("-r and --debug-names may not be used together");
   }
 }
 
@@ -348,6 +360,7 @@ void LinkerDriver::main(ArrayRef<const char *> ArgsArr, bool CanExitEarly) {
     return;
 
   Config->ExitEarly = CanExitEarly && !Args.hasArg(OPT_full_shutdown);
+  startTimers();
 
   if (const char *Path = getReproduceOption(Args)) {
     // Note that --reproduce is a debug option so you can ignore it
@@ -367,7 +380,10 @@ void LinkerDriver::main(ArrayRef<const char *> ArgsArr, bool CanExitEarly) {
 
   readConfigs(Args);
   initLLVM(Args);
-  createFiles(Args);
+  {
+    ScopedTimer T(LoadTimer);
+    createFiles(Args);
+  }
   inferMachineType();
   setConfigs();
   checkOptions(Args);
@@ -377,19 +393,20 @@ void LinkerDriver::main(ArrayRef<const char *> ArgsArr, bool CanExitEarly) {
   switch (Config->EKind) {
   case ELF32LEKind:
     link<ELF32LE>(Args);
-    return;
+    break;
   case ELF32BEKind:
     link<ELF32BE>(Args);
-    return;
+    break;
   case ELF64LEKind:
     link<ELF64LE>(Args);
-    return;
+    break;
   case ELF64BEKind:
     link<ELF64BE>(Args);
-    return;
+    break;
   default:
     llvm_unreachable("unknown Config->EKind");
   }
+  reportTimers();
 }
 
 static bool getArg(opt::InputArgList &Args, unsigned K1, unsigned K2,
@@ -547,6 +564,29 @@ static SortSectionPolicy getSortSection(opt::InputArgList &Args) {
   return SortSectionPolicy::Default;
 }
 
+// Parse --icf-data=<mode>.
+static ICFDataPolicy getICFData(opt::InputArgList &Args) {
+  StringRef S = Args.getLastArgValue(OPT_icf_data, "none");
+  if (S == "safe")
+    return ICFDataPolicy::Safe;
+  if (S == "all")
+    return ICFDataPolicy::All;
+  if (S != "none")
+    error("unknown --icf-data mode: " + S);
+  return ICFDataPolicy::None;
+}
+
+// Parse --pack-dyn-relocs=<format>. Returns true if relative relocations
+// should be packed into .relr.dyn.
+static bool getPackDynRelocs(opt::InputArgList &Args) {
+  StringRef S = Args.getLastArgValue(OPT_pack_dyn_relocs, "none");
+  if (S == "relr")
+    return true;
+  if (S != "none")
+    error("unknown -pack-dyn-relocs format: " + S);
+  return false;
+}
+
 static std::pair<bool, bool> getHashStyle(opt::InputArgList &Args) {
   StringRef S = Args.getLastArgValue(OPT_hash_style, "sysv");
   if (S == "sysv")
@@ -616,6 +656,9 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->Bsymbolic = Args.hasArg(OPT_Bsymbolic);
   Config->BsymbolicFunctions = Args.hasArg(OPT_Bsymbolic_functions);
   Config->CompressDebugSections = getCompressDebugSections(Args);
+  Config->CompressDebugSectionsLevel =
+      getInteger(Args, OPT_compress_debug_sections_level, 6);
+  Config->DebugNames = Args.hasArg(OPT_debug_names);
   Config->DefineCommon = getArg(Args, OPT_define_common, OPT_no_define_common,
                                 !Args.hasArg(OPT_relocatable));
   Config->Demangle = getArg(Args, OPT_demangle, OPT_no_demangle, true);
@@ -634,12 +677,14 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->GcSections = getArg(Args, OPT_gc_sections, OPT_no_gc_sections, false);
   Config->GdbIndex = Args.hasArg(OPT_gdb_index);
   Config->ICF = Args.hasArg(OPT_icf);
+  Config->ICFData = getICFData(Args);
   Config->Init = Args.getLastArgValue(OPT_init, "_init");
   Config->LTOAAPipeline = Args.getLastArgValue(OPT_lto_aa_pipeline);
   Config->LTONewPmPasses = Args.getLastArgValue(OPT_lto_newpm_passes);
   Config->LTOO = getInteger(Args, OPT_lto_O, 2);
   Config->LTOPartitions = getInteger(Args, OPT_lto_partitions, 1);
   Config->MapFile = Args.getLastArgValue(OPT_Map);
+  Config->MmapOutputFile = !Args.hasArg(OPT_no_mmap_output_file);
   Config->NoGnuUnique = Args.hasArg(OPT_no_gnu_unique);
   Config->NoUndefinedVersion = Args.hasArg(OPT_no_undefined_version);
   Config->Nostdlib = Args.hasArg(OPT_nostdlib);
@@ -653,6 +698,7 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->PrintGcSections = Args.hasArg(OPT_print_gc_sections);
   Config->Rpath = getRpath(Args);
   Config->Relocatable = Args.hasArg(OPT_relocatable);
+  Config->RelrPackDynRelocs = getPackDynRelocs(Args);
   Config->SaveTemps = Args.hasArg(OPT_save_temps);
   Config->SearchPaths = getArgs(Args, OPT_L);
   Config->SectionStartMap = getSectionStartMap(Args);
@@ -660,6 +706,7 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->SingleRoRx = Args.hasArg(OPT_no_rosegment);
   Config->SoName = Args.getLastArgValue(OPT_soname);
   Config->SortSection = getSortSection(Args);
+  Config->Stats = Args.hasArg(OPT_stats);
   Config->Strip = getStrip(Args);
   Config->Sysroot = Args.getLastArgValue(OPT_sysroot);
   Config->Target1Rel = getArg(Args, OPT_target1_rel, OPT_target1_abs, false);
@@ -670,6 +717,7 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
       "--thinlto-cache-policy: invalid cache policy");
   Config->ThinLTOJobs = getInteger(Args, OPT_thinlto_jobs, -1u);
   Config->Threads = getArg(Args, OPT_threads, OPT_no_threads, true);
+  Config->TimeTraceFile = Args.getLastArgValue(OPT_time_trace_file);
   Config->Trace = Args.hasArg(OPT_trace);
   Config->Undefined = getArgs(Args, OPT_undefined);
   Config->UnresolvedSymbols = getUnresolvedSymbolPolicy(Args);
@@ -718,9 +766,17 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   std::tie(Config->SysvHash, Config->GnuHash) = getHashStyle(Args);
   std::tie(Config->BuildId, Config->BuildIdVector) = getBuildId(Args);
 
-  if (auto *Arg = Args.getLastArg(OPT_symbol_ordering_file))
+  // If --symbol-ordering-file is given, it overrides call graph profiles
+  // in input files.
+  Config->CallGraphProfileSort = !Args.hasArg(OPT_no_call_graph_profile_sort);
+  if (auto *Arg = Args.getLastArg(OPT_symbol_ordering_file)) {
+    if (Args.hasArg(OPT_call_graph_ordering_file))
+      error("--symbol-ordering-file and --call-graph-ordering-file "
+            "may not be used together");
     if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
       Config->SymbolOrderingFile = getLines(*Buffer);
+    Config->CallGraphProfileSort = false;
+  }
 
   // If --retain-symbol-file is used, we'll keep only the symbols listed in
   // the file and discard all others.
@@ -797,7 +853,37 @@ static bool getBinaryOption(StringRef S) {
   return false;
 }
 
+// Returns the paths of the files that createFiles will read, so that
+// they can be prefetched.
+static std::vector<std::string> getInputPaths(opt::InputArgList &Args) {
+  std::vector<std::string> Ret;
+  bool Static = Config->Static;
+  for (auto *Arg : Args) {
+    switch (Arg->getOption().getID()) {
+    case OPT_l:
+      if (Optional<std::string> Path = searchLibrary(Arg->getValue()))
+        Ret.push_back(*Path);
+      break;
+    case OPT_INPUT:
+    case OPT_alias_script_T:
+    case OPT_script:
+      Ret.push_back(Arg->getValue());
+      break;
+    case OPT_Bstatic:
+      Config->Static = true;
+      break;
+    case OPT_Bdynamic:
+      Config->Static = false;
+      break;
+    }
+  }
+  Config->Static = Static;
+  return Ret;
+}
+
 void LinkerDriver::createFiles(opt::InputArgList &Args) {
+  startPrefetch(getInputPaths(Args));
+
   for (auto *Arg : Args) {
     switch (Arg->getOption().getID()) {
     case OPT_l:
@@ -840,6 +926,7 @@ void LinkerDriver::createFiles(opt::InputArgList &Args) {
       break;
     }
   }
+  stopPrefetch();
 
   if (Files.empty() && ErrorCount == 0)
     error("no input files");
@@ -907,6 +994,81 @@ getDefsym(opt::InputArgList &Args) {
   return Ret;
 }
 
+// Returns the input section that defines a given symbol, or nullptr.
+static const InputSectionBase *getDefiningSection(SymbolBody *B) {
+  auto *D = dyn_cast_or_null<DefinedRegular>(B);
+  if (!D)
+    return nullptr;
+  return dyn_cast_or_null<InputSectionBase>(D->Section);
+}
+
+// Reads a call graph given by --call-graph-ordering-file. Each line of
+// the file is of the form "<caller> <callee> <count>". Symbols that are
+// not defined in input sections are ignored. So are local symbols whose
+// names are defined by more than one file, with a warning.
+template <class ELFT> static void readCallGraph(MemoryBufferRef MB) {
+  DenseMap<StringRef, SymbolBody *> SymbolNameToSymbol;
+  DenseSet<StringRef> Ambiguous;
+  for (elf::ObjectFile<ELFT> *File : Symtab<ELFT>::X->getObjectFiles())
+    for (SymbolBody *Body : File->getSymbols()) {
+      StringRef Name = Body->getName();
+      if (Name.empty())
+        continue;
+      auto P = SymbolNameToSymbol.insert({Name, Body});
+      if (!P.second && P.first->second != Body)
+        Ambiguous.insert(Name);
+    }
+
+  auto Lookup = [&](StringRef Name) -> SymbolBody * {
+    if (Ambiguous.count(Name)) {
+      warn(MB.getBufferIdentifier() + ": ambiguous symbol name: " + Name);
+      return nullptr;
+    }
+    return SymbolNameToSymbol.lookup(Name);
+  };
+
+  for (StringRef Line : getLines(MB)) {
+    SmallVector<StringRef, 3> Fields;
+    Line.split(Fields, ' ', -1, false);
+    uint64_t Count;
+    if (Fields.size() != 3 || Fields[2].getAsInteger(10, Count)) {
+      error(MB.getBufferIdentifier() + ": parse error: " + Line);
+      return;
+    }
+
+    const InputSectionBase *From = getDefiningSection(Lookup(Fields[0]));
+    const InputSectionBase *To = getDefiningSection(Lookup(Fields[1]));
+    if (From && To && Count)
+      Config->CallGraphProfile[{From, To}] += Count;
+  }
+}
+
+// Reads .llvm.call-graph-profile sections. Their symbol indices refer
+// to the symbol tables of the files containing them.
+template <class ELFT> static void readCallGraphsFromObjectFiles() {
+  for (elf::ObjectFile<ELFT> *File : Symtab<ELFT>::X->getObjectFiles()) {
+    ArrayRef<uint8_t> Data = File->CGProfile;
+    if (Data.size() % 16) {
+      error(toString(File) + ": invalid .llvm.call-graph-profile section size");
+      continue;
+    }
+
+    for (size_t I = 0, E = Data.size(); I != E; I += 16) {
+      const uint8_t *P = Data.data() + I;
+      uint32_t FromIdx = read32<ELFT::TargetEndianness>(P);
+      uint32_t ToIdx = read32<ELFT::TargetEndianness>(P + 4);
+      uint64_t Count = read64<ELFT::TargetEndianness>(P + 8);
+
+      const InputSectionBase *From =
+          getDefiningSection(&File->getSymbolBody(FromIdx));
+      const InputSectionBase *To =
+          getDefiningSection(&File->getSymbolBody(ToIdx));
+      if (From && To && Count)
+        Config->CallGraphProfile[{From, To}] += Count;
+    }
+  }
+}
+
 // Do actual linking. Note that when this function is called,
 // all linker scripts have already been parsed.
 template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
@@ -928,6 +1090,9 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
     error("cannot open output file " + Config->OutputFile + ": " + E.message());
   if (auto E = tryCreateFile(Config->MapFile))
     error("cannot open map file " + Config->MapFile + ": " + E.message());
+  if (auto E = tryCreateFile(Config->TimeTraceFile))
+    error("cannot open time trace file " + Config->TimeTraceFile + ": " +
+          E.message());
   if (ErrorCount)
     return;
 
@@ -939,12 +1104,17 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   if (Config->Entry.empty() && !Config->Relocatable)
     Config->Entry = (Config->EMachine == EM_MIPS) ? "__start" : "_start";
 
+  ScopedTimer ResolutionTimer(SymbolResolutionTimer);
+
   // Handle --trace-symbol.
   for (auto *Arg : Args.filtered(OPT_trace_symbol))
     Symtab.trace(Arg->getValue());
 
   // Add all files to the symbol table. This will add almost all
-  // symbols that we need to the symbol table.
+  // symbols that we need to the symbol table. Object files are parsed
+  // in parallel first, and then symbols are resolved in command line
+  // order.
+  Symtab.preParse(Files);
   for (InputFile *F : Files)
     Symtab.addFile(F);
 
@@ -970,7 +1140,10 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   for (std::pair<StringRef, StringRef> &Def : getDefsym(Args))
     Symtab.addSymbolAlias(Def.first, Def.second);
 
-  Symtab.addCombinedLTOObject();
+  {
+    ScopedTimer T(LTOTimer);
+    Symtab.addCombinedLTOObject();
+  }
   if (ErrorCount)
     return;
 
@@ -981,6 +1154,7 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
 
   // Apply symbol renames for -wrap and -defsym
   Symtab.applySymbolRenames();
+  ResolutionTimer.stop();
 
   // Now that we have a complete list of input files.
   // Beyond this point, no new files are added.
@@ -1004,9 +1178,17 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   if (Config->GcSections)
     markLive<ELFT>();
   decompressAndMergeSections();
-  if (Config->ICF)
+  if (Config->ICF || Config->ICFData != ICFDataPolicy::None)
     doIcf<ELFT>();
 
+  // Read call graph profiles to sort sections.
+  if (Config->CallGraphProfileSort) {
+    if (auto *Arg = Args.getLastArg(OPT_call_graph_ordering_file))
+      if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
+        readCallGraph<ELFT>(*Buffer);
+    readCallGraphsFromObjectFiles<ELFT>();
+  }
+
   // Write the result to the file.
   writeResult<ELFT>();
 }
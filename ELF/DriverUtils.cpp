@@ -100,7 +100,7 @@ opt::InputArgList ELFOptTable::parse(ArrayRef<const char *> Argv) {
 
   // Expand response files (arguments in the form of @<filename>)
   // and then parse the argument again.
-  cl::ExpandResponseFiles(Saver, getQuotingStyle(Args), Vec);
+  cl::ExpandResponseFiles(Saver.get(), getQuotingStyle(Args), Vec);
   Args = this->ParseArgs(Vec, MissingIndex, MissingCount);
 
   // Interpret -color-diagnostics early so that error messages
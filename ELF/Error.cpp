@@ -11,6 +11,7 @@
 #include "Config.h"
 
 #include "llvm/ADT/Twine.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
@@ -33,6 +34,15 @@ StringRef elf::Argv0;
 // but outs() or errs() are not thread-safe. We protect them using a mutex.
 static std::mutex Mu;
 
+// The innermost active DiagnosticSuppressor of the current thread.
+static LLVM_THREAD_LOCAL DiagnosticSuppressor *Suppressor = nullptr;
+
+DiagnosticSuppressor::DiagnosticSuppressor() : Prev(Suppressor) {
+  Suppressor = this;
+}
+
+DiagnosticSuppressor::~DiagnosticSuppressor() { Suppressor = Prev; }
+
 // Prints "\n" or does nothing, depending on Msg contents of
 // the previous call of this function.
 static void newline(const Twine &Msg) {
@@ -71,6 +81,11 @@ void elf::message(const Twine &Msg) {
 }
 
 void elf::warn(const Twine &Msg) {
+  if (Suppressor) {
+    ++Suppressor->Count;
+    return;
+  }
+
   if (Config->FatalWarnings) {
     error(Msg);
     return;
@@ -83,6 +98,11 @@ void elf::warn(const Twine &Msg) {
 }
 
 void elf::error(const Twine &Msg) {
+  if (Suppressor) {
+    ++Suppressor->Count;
+    return;
+  }
+
   std::lock_guard<std::mutex> Lock(Mu);
   newline(Msg);
 
@@ -112,6 +132,7 @@ void elf::exitLld(int Val) {
 }
 
 void elf::fatal(const Twine &Msg) {
+  Suppressor = nullptr;
   error(Msg);
   exitLld(1);
 }
@@ -47,6 +47,25 @@ LLVM_ATTRIBUTE_NORETURN void fatal(const Twine &Msg);
 
 LLVM_ATTRIBUTE_NORETURN void exitLld(int Val);
 
+// While an instance of this class is alive, warnings and errors reported
+// by the current thread are not printed but only counted. This is used to
+// do some work speculatively in parallel; if it would report something,
+// the work is redone serially so that diagnostics are printed in a
+// deterministic order. fatal() is not affected.
+class DiagnosticSuppressor {
+public:
+  DiagnosticSuppressor();
+  ~DiagnosticSuppressor();
+  bool hasDiagnostics() const { return Count != 0; }
+
+private:
+  DiagnosticSuppressor *Prev;
+  unsigned Count = 0;
+  friend void warn(const Twine &Msg);
+  friend void error(const Twine &Msg);
+  friend void fatal(const Twine &Msg);
+};
+
 // check() functions are convenient functions to strip errors
 // from error-or-value objects.
 template <class T> T check(ErrorOr<T> E) {
@@ -13,10 +13,20 @@
 
 #include "Filesystem.h"
 #include "Config.h"
-#include "llvm/Support/FileSystem.h"
+#include "Threads.h"
 #include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cerrno>
+#include <mutex>
 #include <thread>
 
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <unistd.h>
+#endif
+
 using namespace llvm;
 
 using namespace lld;
@@ -74,3 +84,131 @@ std::error_code elf::tryCreateFile(StringRef Path) {
     return std::error_code();
   return FileOutputBuffer::create(Path, 1).getError();
 }
+
+namespace {
+// The default output buffer, which mmaps the output file.
+class MmapOutputBuffer final : public OutputBuffer {
+public:
+  MmapOutputBuffer(std::unique_ptr<FileOutputBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+  uint8_t *getBufferStart() override { return Buffer->getBufferStart(); }
+  std::error_code commit() override { return Buffer->commit(); }
+
+private:
+  std::unique_ptr<FileOutputBuffer> Buffer;
+};
+
+// The output buffer for --no-mmap-output-file.
+//
+// Writing a large file through a shared mapping can be very slow on
+// network or FUSE file systems, and an I/O error is reported as SIGBUS
+// instead of an error code. This class instead builds the contents in
+// anonymous memory, which is zero-filled lazily just like a new file.
+// commit() writes the contents to a temporary file with large pwrite(2)
+// calls in parallel, and then renames that file to the output file.
+class StreamingOutputBuffer final : public OutputBuffer {
+public:
+  StreamingOutputBuffer(StringRef Path, sys::MemoryBlock Mem, uint64_t Size)
+      : Path(Path), Mem(Mem), Size(Size) {}
+  ~StreamingOutputBuffer() override { sys::Memory::releaseMappedMemory(Mem); }
+  uint8_t *getBufferStart() override { return (uint8_t *)Mem.base(); }
+  std::error_code commit() override;
+
+private:
+  std::error_code writeFile(int FD);
+
+  std::string Path;
+  sys::MemoryBlock Mem;
+  uint64_t Size;
+};
+} // namespace
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+// Writes a given buffer at a given file offset, retrying short writes.
+static std::error_code writeAt(int FD, const uint8_t *Buf, size_t Size,
+                               uint64_t Off) {
+  while (Size) {
+    ssize_t N = ::pwrite(FD, Buf, Size, Off);
+    if (N < 0) {
+      if (errno == EINTR)
+        continue;
+      return std::error_code(errno, std::generic_category());
+    }
+    Buf += N;
+    Size -= N;
+    Off += N;
+  }
+  return std::error_code();
+}
+
+std::error_code StreamingOutputBuffer::writeFile(int FD) {
+  // Chunks are large enough to make system call overhead negligible and
+  // small enough to keep all threads busy.
+  const uint64_t ChunkSize = 16 * 1024 * 1024;
+  size_t NumChunks = (Size + ChunkSize - 1) / ChunkSize;
+  const uint8_t *Buf = (const uint8_t *)Mem.base();
+
+  std::mutex Mu;
+  std::error_code Ret;
+  parallelForEachN(0, NumChunks, [&](size_t I) {
+    uint64_t Off = I * ChunkSize;
+    std::error_code EC =
+        writeAt(FD, Buf + Off, std::min(ChunkSize, Size - Off), Off);
+    if (EC) {
+      std::lock_guard<std::mutex> Lock(Mu);
+      Ret = EC;
+    }
+  });
+  return Ret;
+}
+#else
+std::error_code StreamingOutputBuffer::writeFile(int FD) {
+  raw_fd_ostream OS(FD, /*shouldClose=*/false);
+  OS.write((const char *)Mem.base(), Size);
+  OS.flush();
+  if (OS.has_error()) {
+    OS.clear_error();
+    return make_error_code(errc::io_error);
+  }
+  return std::error_code();
+}
+#endif
+
+std::error_code StreamingOutputBuffer::commit() {
+  int FD;
+  SmallString<128> TempPath;
+  if (auto EC = sys::fs::createUniqueFile(
+          Path + ".tmp%%%%%%%", FD, TempPath,
+          sys::fs::all_read | sys::fs::all_write | sys::fs::all_exe))
+    return EC;
+
+  std::error_code EC = writeFile(FD);
+  if (std::error_code CloseEC = sys::Process::SafelyCloseFileDescriptor(FD))
+    if (!EC)
+      EC = CloseEC;
+  if (!EC)
+    EC = sys::fs::rename(TempPath, Path);
+  if (EC)
+    sys::fs::remove(TempPath);
+  return EC;
+}
+
+// Creates a buffer for the output file. The file is written when the
+// buffer is committed.
+ErrorOr<std::unique_ptr<OutputBuffer>>
+elf::createOutputBuffer(StringRef Path, uint64_t Size) {
+  if (Config->MmapOutputFile) {
+    ErrorOr<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
+        FileOutputBuffer::create(Path, Size, FileOutputBuffer::F_executable);
+    if (auto EC = BufferOrErr.getError())
+      return EC;
+    return llvm::make_unique<MmapOutputBuffer>(std::move(*BufferOrErr));
+  }
+
+  std::error_code EC;
+  sys::MemoryBlock Mem = sys::Memory::allocateMappedMemory(
+      Size, nullptr, sys::Memory::MF_READ | sys::Memory::MF_WRITE, EC);
+  if (EC)
+    return EC;
+  return llvm::make_unique<StreamingOutputBuffer>(Path, Mem, Size);
+}
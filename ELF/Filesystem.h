@@ -11,9 +11,24 @@
 #define LLD_ELF_FILESYSTEM_H
 
 #include "lld/Core/LLVM.h"
+#include "llvm/Support/ErrorOr.h"
+#include <memory>
 
 namespace lld {
 namespace elf {
+
+// A buffer for the output file. The contents of the output file are
+// written to the buffer, and commit() writes them to the file.
+class OutputBuffer {
+public:
+  virtual ~OutputBuffer() = default;
+  virtual uint8_t *getBufferStart() = 0;
+  virtual std::error_code commit() = 0;
+};
+
+llvm::ErrorOr<std::unique_ptr<OutputBuffer>>
+createOutputBuffer(StringRef Path, uint64_t Size);
+
 void unlinkAsync(StringRef Path);
 std::error_code tryCreateFile(StringRef Path);
 }
@@ -38,6 +38,7 @@ struct CompilationUnitEntry {
 // to build symbol table and constant pool area of gdb index.
 struct NameTypeEntry {
   StringRef Name;
+  uint32_t Hash;
   uint8_t Type;
 };
 
@@ -52,11 +53,16 @@ struct GdbIndexChunk {
 
 // Element of GdbHashTab hash table.
 struct GdbSymbol {
-  GdbSymbol(uint32_t Hash, size_t Offset)
-      : NameHash(Hash), NameOffset(Offset) {}
+  StringRef Name;
   uint32_t NameHash;
   size_t NameOffset;
   size_t CuVectorIndex;
+
+  // Used to sort symbols in the order they first appear in input files.
+  uint64_t FirstSeen;
+
+  // A list of CU indices and symbol kinds in ascending order.
+  std::vector<uint32_t> CuVector;
 };
 
 // This class manages the hashed symbol table for the .gdb_index section.
@@ -64,14 +70,11 @@ struct GdbSymbol {
 // function to the symbol's name.
 class GdbHashTab final {
 public:
-  std::pair<bool, GdbSymbol *> add(uint32_t Hash, size_t Offset);
-
-  void finalizeContents();
+  void finalizeContents(std::vector<GdbSymbol> &Syms);
   size_t getCapacity() { return Table.size(); }
   GdbSymbol *getSymbol(size_t I) { return Table[I]; }
 
 private:
-  llvm::DenseMap<size_t, GdbSymbol *> Map;
   std::vector<GdbSymbol *> Table;
 };
 
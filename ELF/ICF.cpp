@@ -34,10 +34,10 @@
 // terminates are considered identical. Here are details:
 //
 // 1. First, we partition sections using their hash values as keys. Hash
-//    values contain section types, section contents and numbers of
-//    relocations. During this step, relocation targets are not taken into
-//    account. We just put sections that apparently differ into different
-//    equivalence classes.
+//    values contain section types, section contents and relocation types
+//    and offsets. They are then combined with the hash values of
+//    relocation target sections for a few rounds. We just put sections
+//    that apparently differ into different equivalence classes.
 //
 // 2. Next, for each equivalence class, we visit sections to compare
 //    relocation targets. Relocation targets are considered equivalent if
@@ -77,9 +77,13 @@
 #include "Config.h"
 #include "SymbolTable.h"
 #include "Threads.h"
+#include "Timer.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/BinaryFormat/ELF.h"
 #include "llvm/Object/ELF.h"
+#include "llvm/Support/xxhash.h"
 #include <algorithm>
 #include <atomic>
 
@@ -152,19 +156,81 @@ private:
 };
 }
 
-// Returns a hash value for S. Note that the information about
-// relocation targets is not included in the hash value.
+// Returns a hash value of relocation offsets and types. Addends are not
+// included because relocations with different addends can still be
+// constant-equal if they refer to different symbols (see constantEq).
+template <class RelTy> static hash_code hashRelocs(ArrayRef<RelTy> Rels) {
+  hash_code H = 0;
+  for (const RelTy &Rel : Rels)
+    H = hash_combine(H, Rel.r_offset, Rel.getType(Config->IsMips64EL));
+  return H;
+}
+
+// Returns a hash value for S. It covers everything compared by
+// equalsConstant except relocation addends and targets.
 template <class ELFT> static uint32_t getHash(InputSection *S) {
-  return hash_combine(S->Flags, S->getSize(), S->NumRelocations);
+  hash_code H = hash_combine(S->Flags, S->getSize(), S->NumRelocations,
+                             xxHash64(toStringRef(S->Data)));
+  if (S->AreRelocsRela)
+    return hash_combine(H, hashRelocs(S->template relas<ELFT>()));
+  return hash_combine(H, hashRelocs(S->template rels<ELFT>()));
+}
+
+// Combines the hash value of S with the hash values of the sections its
+// relocations refer to. Reads hash values from Class[Cnt % 2] and writes
+// the result to Class[(Cnt + 1) % 2], so that this can run in parallel.
+template <class ELFT, class RelTy>
+static void combineRelocHashes(unsigned Cnt, InputSection *S,
+                               ArrayRef<RelTy> Rels) {
+  hash_code H = S->Class[Cnt % 2];
+  for (const RelTy &Rel : Rels) {
+    SymbolBody &Body = S->template getFile<ELFT>()->getRelocTargetSym(Rel);
+    if (auto *D = dyn_cast<DefinedRegular>(&Body))
+      if (auto *Target = dyn_cast_or_null<InputSection>(D->Section))
+        H = hash_combine(H, Target->Class[Cnt % 2]);
+  }
+  // Set MSB to 1 to avoid collisions with non-hash IDs.
+  S->Class[(Cnt + 1) % 2] = H | (1U << 31);
 }
 
 // Returns true if section S is subject of ICF.
 static bool isEligible(InputSection *S) {
+  if (!S->Live || !(S->Flags & SHF_ALLOC) || (S->Flags & SHF_WRITE))
+    return false;
+
+  // Synthetic sections, such as merged SHF_MERGE sections, have no Data
+  // until they are written, so their contents cannot be compared.
+  if (S->kind() != SectionBase::Regular)
+    return false;
+
   // .init and .fini contains instructions that must be executed to
   // initialize and finalize the process. They cannot and should not
   // be merged.
-  return S->Live && (S->Flags & SHF_ALLOC) && (S->Flags & SHF_EXECINSTR) &&
-         !(S->Flags & SHF_WRITE) && S->Name != ".init" && S->Name != ".fini";
+  if (S->Flags & SHF_EXECINSTR)
+    return Config->ICF && S->Name != ".init" && S->Name != ".fini";
+
+  // Read-only data is folded only if --icf-data is given. Notes and
+  // sections with SHF_LINK_ORDER such as .ARM.exidx have meanings other
+  // than their contents, so they are not subject of ICF.
+  return Config->ICFData != ICFDataPolicy::None && S->Type == SHT_PROGBITS &&
+         !(S->Flags & (SHF_TLS | SHF_LINK_ORDER));
+}
+
+// Returns sections that define named symbols.
+//
+// Distinct objects must have distinct addresses in C and C++, and a
+// program may compare addresses of named objects. Therefore, with
+// --icf-data=safe, we fold only read-only data sections that have no
+// named symbols, such as anonymous constants that are referred to only
+// through section symbols.
+template <class ELFT> static DenseSet<const SectionBase *> getNamedSections() {
+  DenseSet<const SectionBase *> Ret;
+  for (elf::ObjectFile<ELFT> *File : Symtab<ELFT>::X->getObjectFiles())
+    for (SymbolBody *Body : File->getSymbols())
+      if (auto *D = dyn_cast<DefinedRegular>(Body))
+        if (D->Section && !D->isSection())
+          Ret.insert(D->Section);
+  return Ret;
 }
 
 // Split an equivalence class into smaller classes.
@@ -372,18 +438,45 @@ void ICF<ELFT>::forEachClass(std::function<void(size_t, size_t)> Fn) {
   ++Cnt;
 }
 
+static Timer ICFTimer("ICF", Timer::root());
+
 // The main function of ICF.
 template <class ELFT> void ICF<ELFT>::run() {
+  ScopedTimer T(ICFTimer);
+
+  DenseSet<const SectionBase *> NamedSections;
+  if (Config->ICFData == ICFDataPolicy::Safe)
+    NamedSections = getNamedSections<ELFT>();
+
   // Collect sections to merge.
-  for (InputSectionBase *Sec : InputSections)
-    if (auto *S = dyn_cast<InputSection>(Sec))
-      if (isEligible(S))
-        Sections.push_back(S);
+  for (InputSectionBase *Sec : InputSections) {
+    auto *S = dyn_cast<InputSection>(Sec);
+    if (!S || !isEligible(S))
+      continue;
+    if (!(S->Flags & SHF_EXECINSTR) && NamedSections.count(S))
+      continue;
+    Sections.push_back(S);
+  }
 
-  // Initially, we use hash values to partition sections.
-  for (InputSection *S : Sections)
+  // Initially, we use hash values to partition sections. A hash value
+  // covers section contents as well as the hash values of the sections
+  // that relocations refer to, propagated over a few rounds. Sections
+  // that can be identical always have the same hash value, and most
+  // sections that cannot are separated before any pairwise comparison,
+  // which is quadratic in the size of an equivalence class.
+  parallelForEach(Sections.begin(), Sections.end(), [&](InputSection *S) {
     // Set MSB to 1 to avoid collisions with non-hash IDs.
-    S->Class[0] = getHash<ELFT>(S) | (1 << 31);
+    S->Class[0] = getHash<ELFT>(S) | (1U << 31);
+  });
+
+  for (unsigned Round = 0; Round != 2; ++Round) {
+    parallelForEach(Sections.begin(), Sections.end(), [&](InputSection *S) {
+      if (S->AreRelocsRela)
+        combineRelocHashes<ELFT>(Round, S, S->template relas<ELFT>());
+      else
+        combineRelocHashes<ELFT>(Round, S, S->template rels<ELFT>());
+    });
+  }
 
   // From now on, sections in Sections vector are ordered so that sections
   // in the same equivalence class are consecutive in the vector.
@@ -423,7 +516,7 @@ template <class ELFT> void ICF<ELFT>::run() {
     for (InputSectionBase *Sec : InputSections)
       if (auto *S = dyn_cast<InputSection>(Sec))
         if (S->Flags & SHF_LINK_ORDER)
-          S->Live = S->getLinkOrderDep()->Live;
+          S->Live = S->getLinkOrderDep()->Live.load();
 }
 
 // ICF entry point function.
@@ -16,6 +16,7 @@
 #include "Symbols.h"
 #include "SyntheticSections.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/IR/LLVMContext.h"
@@ -23,9 +24,17 @@
 #include "llvm/LTO/LTO.h"
 #include "llvm/MC/StringTableBuilder.h"
 #include "llvm/Object/ELFObjectFile.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/TarWriter.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <future>
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <sys/mman.h>
+#endif
 
 using namespace llvm;
 using namespace llvm::ELF;
@@ -56,9 +65,86 @@ public:
 };
 }
 
+namespace {
+// A file being opened by a prefetch thread.
+struct PrefetchedFile {
+  std::string Path;
+  std::promise<ErrorOr<std::unique_ptr<MemoryBuffer>>> Promise;
+  std::future<ErrorOr<std::unique_ptr<MemoryBuffer>>> Future =
+      Promise.get_future();
+};
+} // namespace
+
+// Prefetched files are looked up only by the main thread.
+static StringMap<std::unique_ptr<PrefetchedFile>> Prefetched;
+static std::vector<std::future<void>> PrefetchThreads;
+
+// Asks the kernel to start reading a given buffer in the background.
+// This is a no-op if the buffer was read into memory instead of mapped.
+static void willNeed(const MemoryBuffer &MB) {
+#if !defined(_MSC_VER) && !defined(__MINGW32__) && defined(MADV_WILLNEED)
+  uintptr_t PageSize = sys::Process::getPageSize();
+  uintptr_t Begin = alignDown((uintptr_t)MB.getBufferStart(), PageSize);
+  uintptr_t End = (uintptr_t)MB.getBufferEnd();
+  if (Begin < End)
+    ::madvise((void *)Begin, End - Begin, MADV_WILLNEED);
+#endif
+}
+
+// On a cold page cache, opening input files one by one and reading them
+// as they are parsed makes a link I/O bound. This function opens files
+// in a few background threads and lets the kernel read ahead their
+// contents, so that disk I/O overlaps with the work on the main thread.
+// Archives are read ahead as a whole because we don't know which
+// members will be loaded until symbols are resolved.
+void elf::startPrefetch(ArrayRef<std::string> Paths) {
+  if (!Config->Threads)
+    return;
+
+  std::vector<PrefetchedFile *> Files;
+  for (const std::string &Path : Paths) {
+    std::unique_ptr<PrefetchedFile> &F = Prefetched[Path];
+    if (F)
+      continue;
+    F = llvm::make_unique<PrefetchedFile>();
+    F->Path = Path;
+    Files.push_back(F.get());
+  }
+  if (Files.empty())
+    return;
+
+  // Opening a file mostly waits for I/O, so a few threads are enough.
+  size_t NumThreads = std::min<size_t>(Files.size(), 4);
+  auto Next = std::make_shared<std::atomic<size_t>>(0);
+  for (size_t I = 0; I < NumThreads; ++I) {
+    PrefetchThreads.push_back(std::async(std::launch::async, [=] {
+      for (size_t J = (*Next)++; J < Files.size(); J = (*Next)++) {
+        auto MBOrErr = MemoryBuffer::getFile(Files[J]->Path);
+        if (MBOrErr)
+          willNeed(**MBOrErr);
+        Files[J]->Promise.set_value(std::move(MBOrErr));
+      }
+    }));
+  }
+}
+
+void elf::stopPrefetch() {
+  PrefetchThreads.clear();
+  Prefetched.clear();
+}
+
+// Returns a file opened by a prefetch thread, or opens it now if it was
+// not prefetched.
+static ErrorOr<std::unique_ptr<MemoryBuffer>> openFile(StringRef Path) {
+  auto It = Prefetched.find(Path);
+  if (It == Prefetched.end() || !It->second->Future.valid())
+    return MemoryBuffer::getFile(Path);
+  return It->second->Future.get();
+}
+
 Optional<MemoryBufferRef> elf::readFile(StringRef Path) {
   log(Path);
-  auto MBOrErr = MemoryBuffer::getFile(Path);
+  auto MBOrErr = openFile(Path);
   if (auto EC = MBOrErr.getError()) {
     error("cannot open " + Path + ": " + EC.message());
     return None;
@@ -191,13 +277,67 @@ ArrayRef<SymbolBody *> elf::ObjectFile<ELFT>::getSymbols() {
   return makeArrayRef(this->SymbolBodies).slice(1);
 }
 
+// Reads section and symbol tables, and creates input sections and local
+// symbols. This function neither depends on nor affects other files, so
+// it is called for object files given on the command line in parallel
+// before symbol resolution starts. Files added later, such as archive
+// members, are pre-parsed by parse().
+//
+// DuplicateGroups are indices of SHT_GROUP sections that are known to be
+// discarded because an earlier file defines the same groups. Members of
+// such groups are not created at all.
+template <class ELFT>
+void elf::ObjectFile<ELFT>::preParse(ArrayRef<uint32_t> DuplicateGroups) {
+  if (PreParsed)
+    return;
+  PreParsed = true;
+  initializeSections(DuplicateGroups);
+  initializeLocalSymbols();
+}
+
 template <class ELFT>
 void elf::ObjectFile<ELFT>::parse(DenseSet<CachedHashStringRef> &ComdatGroups) {
-  // Read section and symbol tables.
-  initializeSections(ComdatGroups);
+  preParse();
+
+  // The rest depends on what files have been added so far,
+  // so it has to be done in command line order.
+  resolveSections(ComdatGroups);
   initializeSymbols();
 }
 
+// Returns the signatures and section indices of comdat groups that
+// resolveSections() will see. Can be called before preParse().
+template <class ELFT>
+std::vector<std::pair<CachedHashStringRef, uint32_t>>
+elf::ObjectFile<ELFT>::getComdatGroups() {
+  ArrayRef<Elf_Shdr> ObjSections =
+      check(this->getObj().sections(), toString(this));
+  this->SectionStringTable = check(
+      this->getObj().getSectionStringTable(ObjSections), toString(this));
+
+  std::vector<std::pair<CachedHashStringRef, uint32_t>> Ret;
+  for (size_t I = 0, E = ObjSections.size(); I < E; ++I) {
+    const Elf_Shdr &Sec = ObjSections[I];
+    if (Sec.sh_type != SHT_GROUP ||
+        ((Sec.sh_flags & SHF_EXCLUDE) && !Config->Relocatable))
+      continue;
+    StringRef Signature = getShtGroupSignature(ObjSections, Sec);
+    Ret.push_back({CachedHashStringRef(Signature), I});
+  }
+  return Ret;
+}
+
+// Returns the names of global symbols. Must be called after preParse().
+template <class ELFT>
+std::vector<CachedHashStringRef>
+elf::ObjectFile<ELFT>::getGlobalSymbolNames() {
+  std::vector<CachedHashStringRef> Ret;
+  for (const Elf_Sym &Sym : this->getGlobalSymbols())
+    Ret.push_back(CachedHashStringRef(
+        check(Sym.getName(this->StringTable), toString(this))));
+  return Ret;
+}
+
 // Sections with SHT_GROUP and comdat bits define comdat section groups.
 // They are identified and deduplicated by group name. This function
 // returns a group name.
@@ -292,9 +432,12 @@ bool elf::ObjectFile<ELFT>::shouldMerge(const Elf_Shdr &Sec) {
   return Sec.sh_addralign <= EntSize;
 }
 
+// Creates input sections. Section groups are handled later by
+// resolveSections(); until then, all groups except DuplicateGroups are
+// assumed to be new.
 template <class ELFT>
 void elf::ObjectFile<ELFT>::initializeSections(
-    DenseSet<CachedHashStringRef> &ComdatGroups) {
+    ArrayRef<uint32_t> DuplicateGroups) {
   const ELFFile<ELFT> &Obj = this->getObj();
 
   ArrayRef<Elf_Shdr> ObjSections =
@@ -318,32 +461,37 @@ void elf::ObjectFile<ELFT>::initializeSections(
     }
 
     switch (Sec.sh_type) {
-    case SHT_GROUP: {
-      // De-duplicate section groups by their signatures.
-      StringRef Signature = getShtGroupSignature(ObjSections, Sec);
-      bool IsNew = ComdatGroups.insert(CachedHashStringRef(Signature)).second;
-      this->Sections[I] = &InputSection::Discarded;
+    case SHT_GROUP:
+      // If an earlier file defines the same group, resolveSections() will
+      // discard this group, so don't bother creating its members.
+      if (std::binary_search(DuplicateGroups.begin(), DuplicateGroups.end(),
+                             I)) {
+        this->Sections[I] = &InputSection::Discarded;
+        for (uint32_t SecIndex : getShtGroupEntries(Sec)) {
+          if (SecIndex >= Size)
+            fatal(toString(this) +
+                  ": invalid section index in group: " + Twine(SecIndex));
+          this->Sections[SecIndex] = &InputSection::Discarded;
+        }
+        continue;
+      }
 
-      // If it is a new section group, we want to keep group members.
       // Group leader sections, which contain indices of group members, are
       // discarded because they are useless beyond this point. The only
       // exception is the -r option because in order to produce re-linkable
       // object files, we want to pass through basically everything.
-      if (IsNew) {
-        if (Config->Relocatable)
-          this->Sections[I] = createInputSection(Sec);
-        continue;
-      }
-
-      // Otherwise, discard group members.
-      for (uint32_t SecIndex : getShtGroupEntries(Sec)) {
-        if (SecIndex >= Size)
-          fatal(toString(this) +
-                ": invalid section index in group: " + Twine(SecIndex));
-        this->Sections[SecIndex] = &InputSection::Discarded;
-      }
+      DeferredSections.push_back(I);
+      if (Config->Relocatable)
+        this->Sections[I] = createInputSection(Sec);
+      else
+        this->Sections[I] = &InputSection::Discarded;
+      continue;
+    case SHT_ARM_ATTRIBUTES:
+      // We retain only the first attribute section in the link. Which one
+      // is the first is decided by resolveSections().
+      DeferredSections.push_back(I);
+      this->Sections[I] = createInputSection(Sec);
       break;
-    }
     case SHT_SYMTAB:
       this->initSymtab(ObjSections, &Sec);
       break;
@@ -360,16 +508,108 @@ void elf::ObjectFile<ELFT>::initializeSections(
 
     // .ARM.exidx sections have a reverse dependency on the InputSection they
     // have a SHF_LINK_ORDER dependency, this is identified by the sh_link.
+    // InputSection::Discarded is shared by all files, so we must not
+    // modify it here.
     if (Sec.sh_flags & SHF_LINK_ORDER) {
       if (Sec.sh_link >= this->Sections.size())
         fatal(toString(this) + ": invalid sh_link index: " +
               Twine(Sec.sh_link));
-      this->Sections[Sec.sh_link]->DependentSections.push_back(
-          this->Sections[I]);
+      InputSectionBase *Target = this->Sections[Sec.sh_link];
+      if (Target != &InputSection::Discarded)
+        Target->DependentSections.push_back(this->Sections[I]);
     }
   }
 }
 
+// Handles sections that initializeSections() deferred because the way
+// to handle them depends on other files.
+template <class ELFT>
+void elf::ObjectFile<ELFT>::resolveSections(
+    DenseSet<CachedHashStringRef> &ComdatGroups) {
+  if (DeferredSections.empty())
+    return;
+
+  ArrayRef<Elf_Shdr> ObjSections =
+      check(this->getObj().sections(), toString(this));
+  bool HasDiscarded = false;
+
+  for (uint32_t I : DeferredSections) {
+    const Elf_Shdr &Sec = ObjSections[I];
+    if (Sec.sh_type == SHT_ARM_ATTRIBUTES)
+      continue;
+
+    // De-duplicate section groups by their signatures.
+    // If it is a new section group, we want to keep group members.
+    StringRef Signature = getShtGroupSignature(ObjSections, Sec);
+    if (ComdatGroups.insert(CachedHashStringRef(Signature)).second)
+      continue;
+
+    // Otherwise, discard the group and its members.
+    this->Sections[I] = &InputSection::Discarded;
+    for (uint32_t SecIndex : getShtGroupEntries(Sec)) {
+      if (SecIndex >= ObjSections.size())
+        fatal(toString(this) +
+              ": invalid section index in group: " + Twine(SecIndex));
+
+      InputSectionBase *S = this->Sections[SecIndex];
+      this->Sections[SecIndex] = &InputSection::Discarded;
+
+      // A discarded section must not keep its SHF_LINK_ORDER
+      // dependency alive.
+      const Elf_Shdr &Member = ObjSections[SecIndex];
+      if (S && (Member.sh_flags & SHF_LINK_ORDER)) {
+        InputSectionBase *Target = this->Sections[Member.sh_link];
+        if (Target && Target != &InputSection::Discarded) {
+          auto &V = Target->DependentSections;
+          V.erase(std::remove(V.begin(), V.end(), S), V.end());
+        }
+      }
+    }
+    HasDiscarded = true;
+  }
+
+  // FIXME: ARM meta-data section. Retain the first attribute section
+  // we see. The eglibc ARM dynamic loaders require the presence of an
+  // attribute section for dlopen to work.
+  // In a full implementation we would merge all attribute sections.
+  for (uint32_t I : DeferredSections) {
+    InputSectionBase *S = this->Sections[I];
+    if (ObjSections[I].sh_type != SHT_ARM_ATTRIBUTES ||
+        S == &InputSection::Discarded)
+      continue;
+    if (InX::ARMAttributes == nullptr) {
+      InX::ARMAttributes = cast<InputSection>(S);
+      continue;
+    }
+    this->Sections[I] = &InputSection::Discarded;
+    HasDiscarded = true;
+  }
+
+  if (!HasDiscarded)
+    return;
+
+  // We do not emit relocation sections for discarded sections.
+  if (Config->Relocatable || Config->EmitRelocs) {
+    for (size_t I = 0, E = ObjSections.size(); I < E; ++I) {
+      const Elf_Shdr &Sec = ObjSections[I];
+      InputSectionBase *S = this->Sections[I];
+      if (S && S != &InputSection::Discarded &&
+          (Sec.sh_type == SHT_REL || Sec.sh_type == SHT_RELA) &&
+          this->Sections[Sec.sh_info] == &InputSection::Discarded)
+        this->Sections[I] = nullptr;
+    }
+  }
+
+  // Local symbols were created before we knew which sections are
+  // discarded. Make them point to InputSection::Discarded as if
+  // discarded sections had never been created.
+  for (size_t I = 0, E = SymbolBodies.size(); I < E; ++I)
+    if (auto *D = dyn_cast<DefinedRegular>(SymbolBodies[I]))
+      if (D->Section && this->Sections[this->getSectionIndex(
+                            this->Symbols[I])] == &InputSection::Discarded)
+        D->Section = &InputSection::Discarded;
+}
+
 template <class ELFT>
 InputSectionBase *elf::ObjectFile<ELFT>::getRelocTarget(const Elf_Shdr &Sec) {
   uint32_t Idx = Sec.sh_info;
@@ -404,15 +644,8 @@ elf::ObjectFile<ELFT>::createInputSection(const Elf_Shdr &Sec) {
 
   switch (Sec.sh_type) {
   case SHT_ARM_ATTRIBUTES:
-    // FIXME: ARM meta-data section. Retain the first attribute section
-    // we see. The eglibc ARM dynamic loaders require the presence of an
-    // attribute section for dlopen to work.
-    // In a full implementation we would merge all attribute sections.
-    if (InX::ARMAttributes == nullptr) {
-      InX::ARMAttributes = make<InputSection>(this, &Sec, Name);
-      return InX::ARMAttributes;
-    }
-    return &InputSection::Discarded;
+    // Only the first one is retained. See resolveSections().
+    return make<InputSection>(this, &Sec, Name);
   case SHT_RELA:
   case SHT_REL: {
     // Find the relocation target section and associate this
@@ -513,6 +746,18 @@ elf::ObjectFile<ELFT>::createInputSection(const Elf_Shdr &Sec) {
       (Name == ".debug_gnu_pubnames" || Name == ".debug_gnu_pubtypes"))
     return &InputSection::Discarded;
 
+  // If --debug-names is given, LLD creates .debug_names section. Input
+  // .debug_names sections cannot simply be concatenated, so drop them.
+  if (Config->DebugNames && Name == ".debug_names")
+    return &InputSection::Discarded;
+
+  // A call graph profile is used to sort sections and is not copied to
+  // the output. See CallGraphSort.cpp.
+  if (Name == ".llvm.call-graph-profile") {
+    CGProfile = check(this->getObj().getSectionContents(&Sec), toString(this));
+    return &InputSection::Discarded;
+  }
+
   // The linkonce feature is a sort of proto-comdat. Some glibc i386 object
   // files contain definitions of symbol "__x86.get_pc_thunk.bx" in linkonce
   // sections. Drop those sections to avoid duplicate symbol errors.
@@ -538,9 +783,20 @@ StringRef elf::ObjectFile<ELFT>::getSectionName(const Elf_Shdr &Sec) {
                toString(this));
 }
 
-template <class ELFT> void elf::ObjectFile<ELFT>::initializeSymbols() {
+// Creates local symbols. They can be created in parallel because they
+// don't need to be inserted to the symbol table.
+template <class ELFT> void elf::ObjectFile<ELFT>::initializeLocalSymbols() {
   SymbolBodies.reserve(this->Symbols.size());
-  for (const Elf_Sym &Sym : this->Symbols)
+  for (const Elf_Sym &Sym : this->Symbols.slice(0, this->FirstNonLocal)) {
+    if (Sym.getBinding() != STB_LOCAL)
+      break;
+    SymbolBodies.push_back(createSymbolBody(&Sym));
+  }
+}
+
+// Creates the remaining symbols. Global symbols are resolved here.
+template <class ELFT> void elf::ObjectFile<ELFT>::initializeSymbols() {
+  for (const Elf_Sym &Sym : this->Symbols.slice(SymbolBodies.size()))
     SymbolBodies.push_back(createSymbolBody(&Sym));
 }
 
@@ -808,6 +1064,25 @@ template <class ELFT> void SharedFile<ELFT>::parseRest() {
   }
 }
 
+template <class ELFT>
+ArrayRef<SharedSymbol *> SharedFile<ELFT>::getSymbolsAt(uint64_t Shndx,
+                                                       uint64_t Value) {
+  if (!SymbolsAtIndexed) {
+    SymbolsAtIndexed = true;
+    for (const Elf_Sym &S : this->getGlobalSymbols()) {
+      StringRef Name = check(S.getName(this->StringTable), toString(this));
+      SymbolBody *Sym = Symtab<ELFT>::X->find(Name);
+      if (auto *Alias = dyn_cast_or_null<SharedSymbol>(Sym))
+        SymbolsAt[{S.st_shndx, S.st_value}].push_back(Alias);
+    }
+  }
+
+  auto It = SymbolsAt.find({Shndx, Value});
+  if (It == SymbolsAt.end())
+    return {};
+  return It->second;
+}
+
 static ELFKind getBitcodeELFKind(const Triple &T) {
   if (T.isLittleEndian())
     return T.isArch64Bit() ? ELF64LEKind : ELF32LEKind;
@@ -58,6 +58,12 @@ extern llvm::TarWriter *Tar;
 // Opens a given file.
 llvm::Optional<MemoryBufferRef> readFile(StringRef Path);
 
+// Starts opening and reading given files in background threads, so that
+// readFile doesn't have to wait for disk I/O. stopPrefetch waits for the
+// threads and discards files that have not been passed to readFile.
+void startPrefetch(ArrayRef<std::string> Paths);
+void stopPrefetch();
+
 // The root class of input files.
 class InputFile {
 public:
@@ -157,7 +163,11 @@ public:
   ArrayRef<SymbolBody *> getLocalSymbols();
 
   ObjectFile(MemoryBufferRef M, StringRef ArchiveName);
+  std::vector<std::pair<llvm::CachedHashStringRef, uint32_t>>
+  getComdatGroups();
+  void preParse(ArrayRef<uint32_t> DuplicateGroups = {});
   void parse(llvm::DenseSet<llvm::CachedHashStringRef> &ComdatGroups);
+  std::vector<llvm::CachedHashStringRef> getGlobalSymbolNames();
 
   InputSectionBase *getSection(const Elf_Sym &Sym) const;
 
@@ -188,9 +198,15 @@ public:
   // symbol table.
   StringRef SourceFile;
 
+  // Contents of the .llvm.call-graph-profile section. Each entry is a
+  // pair of 32-bit symbol indices followed by a 64-bit call count.
+  ArrayRef<uint8_t> CGProfile;
+
 private:
+  void initializeSections(ArrayRef<uint32_t> DuplicateGroups);
+  void initializeLocalSymbols();
   void
-  initializeSections(llvm::DenseSet<llvm::CachedHashStringRef> &ComdatGroups);
+  resolveSections(llvm::DenseSet<llvm::CachedHashStringRef> &ComdatGroups);
   void initializeSymbols();
   void initializeDwarfLine();
   InputSectionBase *getRelocTarget(const Elf_Shdr &Sec);
@@ -203,6 +219,13 @@ private:
   // List of all symbols referenced or defined by this file.
   std::vector<SymbolBody *> SymbolBodies;
 
+  // Indices of sections that cannot be handled by preParse() because
+  // the way to handle them depends on other files (e.g. SHT_GROUP).
+  std::vector<uint32_t> DeferredSections;
+
+  // True if preParse() has been called.
+  bool PreParsed = false;
+
   // .shstrtab contents.
   StringRef SectionStringTable;
 
@@ -291,12 +314,23 @@ template <class ELFT> class SharedFile : public ELFFileBase<ELFT> {
   const Elf_Shdr *VersymSec = nullptr;
   const Elf_Shdr *VerdefSec = nullptr;
 
+  // An index for getSymbolsAt(). Built on first use because only DSOs
+  // that define copy-relocated symbols need it.
+  llvm::DenseMap<std::pair<uint64_t, uint64_t>, std::vector<SharedSymbol *>>
+      SymbolsAt;
+  bool SymbolsAtIndexed = false;
+
 public:
   std::string SoName;
 
   const Elf_Shdr *getSection(const Elf_Sym &Sym) const;
   llvm::ArrayRef<StringRef> getUndefinedSymbols() { return Undefs; }
 
+  // Returns the symbols that are defined at a given section index and value
+  // in this file, i.e. a symbol and all of its aliases. Used to copy all
+  // aliases of a symbol that needs a copy relocation.
+  llvm::ArrayRef<SharedSymbol *> getSymbolsAt(uint64_t Shndx, uint64_t Value);
+
   static bool classof(const InputFile *F) {
     return F->kind() == Base::SharedKind;
   }
@@ -23,9 +23,8 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Path.h"
-#include "llvm/Support/Threading.h"
-#include <mutex>
 
 using namespace llvm;
 using namespace llvm::ELF;
@@ -177,12 +176,7 @@ void InputSectionBase::uncompress() {
                                                 Config->IsLE, Config->Is64));
 
   size_t Size = Dec.getDecompressedSize();
-  char *OutputBuf;
-  {
-    static std::mutex Mu;
-    std::lock_guard<std::mutex> Lock(Mu);
-    OutputBuf = BAlloc.Allocate<char>(Size);
-  }
+  char *OutputBuf = BAlloc.Allocate<char>(Size);
 
   if (Error E = Dec.decompress({OutputBuf, Size}))
     fatal(toString(this) +
@@ -819,17 +813,44 @@ void EhInputSection::split(ArrayRef<RelTy> Rels) {
   }
 }
 
+// Returns true if a given 8-byte word contains an EntSize-byte element
+// that is zero. EntSize must be 2 or 4. This is the usual SWAR trick: a
+// lane's most significant bit survives only if subtracting one from the
+// lane borrowed, which happens for the lowest zero lane. Lanes above it
+// may be false positives, but the word as a whole is reported correctly.
+static bool hasZeroElement(uint64_t X, size_t EntSize) {
+  if (EntSize == 2)
+    return (X - 0x0001000100010001) & ~X & 0x8000800080008000;
+  return (X - 0x0000000100000001) & ~X & 0x8000000080000000;
+}
+
+static bool isNullElement(const uint8_t *P, size_t EntSize) {
+  return std::all_of(P, P + EntSize, [](uint8_t C) { return C == 0; });
+}
+
 static size_t findNull(ArrayRef<uint8_t> A, size_t EntSize) {
-  // Optimize the common case.
+  // Optimize the common case. memchr is vectorized by the C library.
   StringRef S((const char *)A.data(), A.size());
   if (EntSize == 1)
     return S.find(0);
 
-  for (unsigned I = 0, N = S.size(); I != N; I += EntSize) {
-    const char *B = S.begin() + I;
-    if (std::all_of(B, B + EntSize, [](char C) { return C == 0; }))
-      return I;
+  // For UTF-16 and UTF-32 strings, skip eight bytes at a time until we
+  // find a word that contains a null character. A always starts at an
+  // element boundary, so words are aligned to elements.
+  size_t I = 0;
+  size_t N = A.size();
+  if (EntSize == 2 || EntSize == 4) {
+    for (; I + 8 <= N; I += 8) {
+      uint64_t X;
+      memcpy(&X, A.data() + I, sizeof(X));
+      if (hasZeroElement(X, EntSize))
+        break;
+    }
   }
+
+  for (; I + EntSize <= N; I += EntSize)
+    if (isNullElement(A.data() + I, EntSize))
+      return I;
   return StringRef::npos;
 }
 
@@ -861,6 +882,8 @@ void MergeInputSection::splitNonStrings(ArrayRef<uint8_t> Data,
   size_t Size = Data.size();
   assert((Size % EntSize) == 0);
   bool IsAlloc = this->Flags & SHF_ALLOC;
+  Pieces.reserve(Size / EntSize);
+  Hashes.reserve(Size / EntSize);
   for (unsigned I = 0, N = Size; I != N; I += EntSize) {
     Hashes.push_back(hash_value(toStringRef(Data.slice(I, EntSize))));
     Pieces.emplace_back(I, !IsAlloc);
@@ -878,7 +901,8 @@ MergeInputSection::MergeInputSection(elf::ObjectFile<ELFT> *F,
 // into small chunks for further processing.
 //
 // Note that this function is called from parallel_for_each. This must be
-// thread-safe (i.e. no memory allocation from the pools).
+// thread-safe. Allocating memory from the arenas is fine because each
+// thread has its own arenas.
 void MergeInputSection::splitIntoPieces() {
   ArrayRef<uint8_t> Data = this->Data;
   uint64_t EntSize = this->Entsize;
@@ -887,9 +911,34 @@ void MergeInputSection::splitIntoPieces() {
   else
     splitNonStrings(Data, EntSize);
 
+  if (this->Flags & SHF_STRINGS)
+    buildPieceIndex();
+
   if (Config->GcSections && (this->Flags & SHF_ALLOC))
     for (uint64_t Off : LiveOffsets)
       this->getSectionPiece(Off)->Live = true;
+  LiveOffsets = DenseSet<uint64_t>();
+}
+
+// Builds PieceIndex so that each entry covers about eight pieces on
+// average. A lookup then reads a few cache lines instead of doing a
+// binary search over all pieces or a hash table lookup.
+void MergeInputSection::buildPieceIndex() {
+  if (Pieces.size() < 16)
+    return;
+
+  uint64_t Size = this->Data.size();
+  uint64_t AvgSize = std::max<uint64_t>(Size / Pieces.size(), 1);
+  PieceIndexShift = Log2_64_Ceil(AvgSize * 8);
+  PieceIndex.resize((Size >> PieceIndexShift) + 1);
+
+  size_t P = 0;
+  for (size_t I = 0, E = PieceIndex.size(); I != E; ++I) {
+    uint64_t Off = (uint64_t)I << PieceIndexShift;
+    while (P + 1 < Pieces.size() && Pieces[P + 1].InputOff <= Off)
+      ++P;
+    PieceIndex[I] = P;
+  }
 }
 
 bool MergeInputSection::classof(const SectionBase *S) {
@@ -920,9 +969,25 @@ const SectionPiece *MergeInputSection::getSectionPiece(uint64_t Offset) const {
   if (Offset >= Size)
     fatal(toString(this) + ": entry is past the end of the section");
 
+  // Fixed-size pieces can be found by a division.
+  if (!(this->Flags & SHF_STRINGS))
+    return &Pieces[Offset / this->Entsize];
+
+  // Narrow down the range using the skip index. The piece containing
+  // Offset is between the pieces containing the beginning of Offset's
+  // index entry and the beginning of the next one.
+  size_t Begin = 0;
+  size_t End = Pieces.size();
+  if (!PieceIndex.empty()) {
+    size_t I = Offset >> PieceIndexShift;
+    Begin = PieceIndex[I];
+    if (I + 1 < PieceIndex.size())
+      End = PieceIndex[I + 1] + 1;
+  }
+
   // Find the element this offset points to.
   auto I = fastUpperBound(
-      Pieces.begin(), Pieces.end(), Offset,
+      Pieces.begin() + Begin, Pieces.begin() + End, Offset,
       [](const uint64_t &A, const SectionPiece &B) { return A < B.InputOff; });
   --I;
   return &*I;
@@ -932,23 +997,9 @@ const SectionPiece *MergeInputSection::getSectionPiece(uint64_t Offset) const {
 // Because contents of a mergeable section is not contiguous in output,
 // it is not just an addition to a base output offset.
 uint64_t MergeInputSection::getOffset(uint64_t Offset) const {
-  // Initialize OffsetMap lazily.
-  llvm::call_once(InitOffsetMap, [&] {
-    OffsetMap.reserve(Pieces.size());
-    for (const SectionPiece &Piece : Pieces)
-      OffsetMap[Piece.InputOff] = Piece.OutputOff;
-  });
-
-  // Find a string starting at a given offset.
-  auto It = OffsetMap.find(Offset);
-  if (It != OffsetMap.end())
-    return It->second;
-
   if (!this->Live)
     return 0;
 
-  // If Offset is not at beginning of a section piece, it is not in the map.
-  // In that case we need to search from the original section piece vector.
   const SectionPiece &Piece = *this->getSectionPiece(Offset);
   if (!Piece.Live)
     return 0;
@@ -18,7 +18,7 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Object/ELF.h"
-#include "llvm/Support/Threading.h"
+#include <atomic>
 #include <mutex>
 
 namespace lld {
@@ -49,12 +49,8 @@ public:
 
   unsigned SectionKind : 3;
 
-  // The next two bit fields are only used by InputSectionBase, but we
-  // put them here so the struct packs better.
-
-  // The garbage collector sets sections' Live bits.
-  // If GC is disabled, all sections are considered live by default.
-  unsigned Live : 1;     // for garbage collection
+  // The next bit field is only used by InputSectionBase, but we
+  // put it here so the struct packs better.
   unsigned Assigned : 1; // for linker script
 
   uint32_t Alignment;
@@ -66,6 +62,11 @@ public:
   uint32_t Link;
   uint32_t Info;
 
+  // The garbage collector sets sections' Live bits.
+  // If GC is disabled, all sections are considered live by default.
+  // This is atomic because the garbage collector runs in parallel.
+  std::atomic<bool> Live;
+
   OutputSection *getOutputSection();
   const OutputSection *getOutputSection() const {
     return const_cast<SectionBase *>(this)->getOutputSection();
@@ -210,8 +211,10 @@ public:
   void splitIntoPieces();
 
   // Mark the piece at a given offset live. Used by GC.
+  // This function is thread-safe.
   void markLiveAt(uint64_t Offset) {
     assert(this->Flags & llvm::ELF::SHF_ALLOC);
+    std::lock_guard<std::mutex> Lock(LiveOffsetsMu);
     LiveOffsets.insert(Offset);
   }
 
@@ -238,6 +241,14 @@ public:
     return {S, Hashes[I]};
   }
 
+  // Returns I'th piece's hash value. Merge synthetic sections use it to
+  // distribute pieces to shards.
+  uint32_t getHash(size_t I) const { return Hashes[I]; }
+
+  // Frees hash values once pieces have been deduplicated. getData() and
+  // getHash() must not be called after this.
+  void freeHashes() { std::vector<uint32_t>().swap(Hashes); }
+
   // Returns the SectionPiece at a given input section offset.
   SectionPiece *getSectionPiece(uint64_t Offset);
   const SectionPiece *getSectionPiece(uint64_t Offset) const;
@@ -247,13 +258,18 @@ public:
 private:
   void splitStrings(ArrayRef<uint8_t> A, size_t Size);
   void splitNonStrings(ArrayRef<uint8_t> A, size_t Size);
+  void buildPieceIndex();
 
   std::vector<uint32_t> Hashes;
 
-  mutable llvm::DenseMap<uint64_t, uint64_t> OffsetMap;
-  mutable llvm::once_flag InitOffsetMap;
+  // A skip index to find pieces of SHF_STRINGS sections quickly.
+  // PieceIndex[I] is the index of the piece that contains input offset
+  // (I << PieceIndexShift). Fixed-size pieces don't need this.
+  std::vector<uint32_t> PieceIndex;
+  uint8_t PieceIndexShift = 0;
 
   llvm::DenseSet<uint64_t> LiveOffsets;
+  std::mutex LiveOffsetsMu;
 };
 
 struct EhSectionPiece : public SectionPiece {
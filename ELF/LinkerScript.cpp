@@ -41,6 +41,10 @@
 #include <string>
 #include <vector>
 
+#ifdef LLD_HAS_ZLIB
+#include <zlib.h>
+#endif
+
 using namespace llvm;
 using namespace llvm::ELF;
 using namespace llvm::object;
@@ -277,6 +281,90 @@ static void sortSections(InputSection **Begin, InputSection **End,
     std::stable_sort(Begin, End, getComparator(K));
 }
 
+// Returns the part of a glob pattern before the first metacharacter.
+static StringRef getLiteralPrefix(StringRef Pat) {
+  return Pat.substr(0, Pat.find_first_of("?*[\\"));
+}
+
+void LinkerScript::buildInputSectionIndex() {
+  Index = InputSectionIndex();
+  for (InputSectionBase *Sec : InputSections) {
+    if (!Sec->Live)
+      continue;
+
+    // For -emit-relocs we have to ignore entries like
+    //   .rela.dyn : { *(.rela.data) }
+    // which are common because they are in the default bfd script.
+    if (Sec->Type == SHT_REL || Sec->Type == SHT_RELA)
+      continue;
+
+    uint32_t I = Index.Sections.size();
+    Index.Sections.push_back(Sec);
+    Index.Filenames.push_back(basename(Sec));
+    Index.ByName[Sec->Name].push_back(I);
+    Index.ByFilename[Index.Filenames.back()].push_back(I);
+    Index.SortedNames.push_back({Sec->Name, I});
+  }
+  std::sort(Index.SortedNames.begin(), Index.SortedNames.end());
+}
+
+// Returns positions of sections in Index.Sections that may be matched by
+// a given pattern, in ascending order. The returned sections are only
+// candidates; callers still need to check if they really match.
+std::vector<uint32_t>
+LinkerScript::getCandidates(const InputSectionDescription *Cmd,
+                            const SectionPattern &Pat) {
+  // Try to look up candidates by section name. This works if all
+  // patterns have non-empty literal prefixes.
+  std::vector<uint32_t> ByName;
+  bool HasByName = true;
+  for (StringRef P : Pat.SectionPat.getPatterns()) {
+    StringRef Prefix = getLiteralPrefix(P);
+    if (Prefix.empty()) {
+      HasByName = false;
+      break;
+    }
+    if (Prefix.size() == P.size()) {
+      auto It = Index.ByName.find(P);
+      if (It != Index.ByName.end())
+        ByName.insert(ByName.end(), It->second.begin(), It->second.end());
+      continue;
+    }
+    auto It = std::lower_bound(Index.SortedNames.begin(),
+                               Index.SortedNames.end(),
+                               std::make_pair(Prefix, (uint32_t)0));
+    for (; It != Index.SortedNames.end() && It->first.startswith(Prefix); ++It)
+      ByName.push_back(It->second);
+  }
+
+  // Try to look up candidates by file name. This works if all patterns
+  // are literals.
+  std::vector<uint32_t> ByFile;
+  bool HasByFile = true;
+  for (StringRef P : Cmd->FilePat.getPatterns()) {
+    if (getLiteralPrefix(P).size() != P.size()) {
+      HasByFile = false;
+      break;
+    }
+    auto It = Index.ByFilename.find(P);
+    if (It != Index.ByFilename.end())
+      ByFile.insert(ByFile.end(), It->second.begin(), It->second.end());
+  }
+
+  std::vector<uint32_t> Ret;
+  if (HasByName && (!HasByFile || ByName.size() <= ByFile.size()))
+    Ret = std::move(ByName);
+  else if (HasByFile)
+    Ret = std::move(ByFile);
+  else
+    for (uint32_t I = 0, E = Index.Sections.size(); I != E; ++I)
+      Ret.push_back(I);
+
+  std::sort(Ret.begin(), Ret.end());
+  Ret.erase(std::unique(Ret.begin(), Ret.end()), Ret.end());
+  return Ret;
+}
+
 // Compute and remember which sections the InputSectionDescription matches.
 std::vector<InputSection *>
 LinkerScript::computeInputSections(const InputSectionDescription *Cmd) {
@@ -286,22 +374,22 @@ LinkerScript::computeInputSections(const InputSectionDescription *Cmd) {
   for (const SectionPattern &Pat : Cmd->SectionPatterns) {
     size_t SizeBefore = Ret.size();
 
-    for (InputSectionBase *Sec : InputSections) {
-      if (Sec->Assigned)
-        continue;
+    // The index doesn't contain dead sections, so we need to visit all
+    // sections to report them.
+    if (Config->PrintGcSections)
+      for (InputSectionBase *Sec : InputSections)
+        if (!Sec->Assigned && !Sec->Live)
+          reportDiscarded(Sec);
 
-      if (!Sec->Live) {
-        reportDiscarded(Sec);
-        continue;
-      }
+    for (uint32_t I : getCandidates(Cmd, Pat)) {
+      InputSectionBase *Sec = Index.Sections[I];
 
-      // For -emit-relocs we have to ignore entries like
-      //   .rela.dyn : { *(.rela.data) }
-      // which are common because they are in the default bfd script.
-      if (Sec->Type == SHT_REL || Sec->Type == SHT_RELA)
+      // Sections may have been discarded by /DISCARD/ after the index
+      // was built.
+      if (Sec->Assigned || !Sec->Live)
         continue;
 
-      StringRef Filename = basename(Sec);
+      StringRef Filename = Index.Filenames[I];
       if (!Cmd->FilePat.match(Filename) ||
           Pat.ExcludedFilePat.match(Filename) ||
           !Pat.SectionPat.match(Sec->Name))
@@ -375,6 +463,7 @@ void LinkerScript::processCommands(OutputSectionFactory &Factory) {
   Aether->SectionIndex = 1;
   CurOutSec = Aether;
   Dot = 0;
+  buildInputSectionIndex();
 
   for (size_t I = 0; I < Opt.Commands.size(); ++I) {
     // Handle symbol assignments outside of any output section.
@@ -436,6 +525,7 @@ void LinkerScript::processCommands(OutputSectionFactory &Factory) {
     }
   }
   CurOutSec = nullptr;
+  Index = InputSectionIndex();
 }
 
 void LinkerScript::fabricateDefaultCommands() {
@@ -830,11 +920,15 @@ allocateHeaders(std::vector<PhdrEntry> &Phdrs,
   return false;
 }
 
-void LinkerScript::assignAddresses(std::vector<PhdrEntry> &Phdrs) {
-  // Assign addresses as instructed by linker script SECTIONS sub-commands.
+// Assign addresses as instructed by linker script SECTIONS sub-commands.
+// This may be called more than once before the program headers are
+// finalized, e.g. to see if branches are in range while creating thunks.
+void LinkerScript::assignAddresses() {
   Dot = 0;
   ErrorOnMissingSection = true;
   switchTo(Aether);
+  for (auto &KV : Opt.MemoryRegions)
+    KV.second.Offset = KV.second.Origin;
 
   for (BaseCommand *Base : Opt.Commands) {
     if (auto *Cmd = dyn_cast<SymbolAssignment>(Base)) {
@@ -850,6 +944,10 @@ void LinkerScript::assignAddresses(std::vector<PhdrEntry> &Phdrs) {
     auto *Cmd = cast<OutputSectionCommand>(Base);
     assignOffsets(Cmd);
   }
+}
+
+void LinkerScript::assignAddresses(std::vector<PhdrEntry> &Phdrs) {
+  assignAddresses();
 
   uint64_t MinVA = std::numeric_limits<uint64_t>::max();
   for (OutputSectionCommand *Cmd : OutputSectionCommands) {
@@ -1013,6 +1111,59 @@ template <class ELFT> void OutputSectionCommand::finalize() {
 }
 
 // Compress section contents if this section contains debug info.
+#ifdef LLD_HAS_ZLIB
+// Compresses a given buffer using raw deflate. Unless Last is true, the
+// output ends with a full flush, which byte-aligns it and resets the
+// compression state, so that it can be followed by other deflate streams.
+// Reserve bytes are left uninitialized at the beginning of the result.
+static std::vector<uint8_t> deflateShard(ArrayRef<uint8_t> In, size_t Reserve,
+                                         bool Last) {
+  z_stream S = {};
+  if (deflateInit2(&S, Config->CompressDebugSectionsLevel, Z_DEFLATED, -15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    fatal("--compress-debug-sections: deflateInit2 failed");
+
+  // deflateBound() is for Z_FINISH. A full flush emits a few more bytes.
+  std::vector<uint8_t> Out(Reserve + deflateBound(&S, In.size()) + 16);
+  S.next_in = const_cast<uint8_t *>(In.data());
+  S.avail_in = In.size();
+  S.next_out = Out.data() + Reserve;
+  S.avail_out = Out.size() - Reserve;
+
+  int Ret = deflate(&S, Last ? Z_FINISH : Z_FULL_FLUSH);
+  if (Ret != (Last ? Z_STREAM_END : Z_OK) || S.avail_in != 0)
+    fatal("--compress-debug-sections: deflate failed");
+  Out.resize(Out.size() - S.avail_out);
+  deflateEnd(&S);
+  return Out;
+}
+#else
+static zlib::CompressionLevel getCompressionLevel() {
+  switch (Config->CompressDebugSectionsLevel) {
+  case 0:
+    return zlib::NoCompression;
+  case 1:
+    return zlib::BestSpeedCompression;
+  case 9:
+    return zlib::BestSizeCompression;
+  default:
+    return zlib::DefaultCompression;
+  }
+}
+#endif
+
+// Debug sections can be very large, so we compress them in fixed-size
+// shards in parallel. Each shard is a raw deflate stream, and they are
+// concatenated with a zlib header and a checksum to form a single zlib
+// stream.
+//
+// Shards are written from input sections directly, so we don't need a
+// temporary buffer for the whole section. An input section that
+// straddles shard boundaries, such as a merged .debug_str, is written to
+// a buffer of its own first and then copied to each shard in slices.
+//
+// If lld is built without zlib.h, we can only use LLVM's API, which
+// creates a complete zlib stream, so the section becomes a single shard.
 template <class ELFT> void OutputSectionCommand::maybeCompress() {
   typedef typename ELFT::Chdr Elf_Chdr;
 
@@ -1028,14 +1179,122 @@ template <class ELFT> void OutputSectionCommand::maybeCompress() {
   Hdr->ch_size = Sec->Size;
   Hdr->ch_addralign = Sec->Alignment;
 
-  // Write section contents to a temporary buffer and compress it.
+#ifdef LLD_HAS_ZLIB
+  const uint64_t ShardSize = 1 << 20;
+#else
+  const uint64_t ShardSize = std::max<uint64_t>(Sec->Size, 1);
+#endif
+  size_t NumShards =
+      std::max<uint64_t>((Sec->Size + ShardSize - 1) / ShardSize, 1);
+
+  // Distribute input sections to the shards they overlap.
+  std::vector<InputSection *> Straddling;
+  std::vector<std::vector<InputSection *>> ShardSections(NumShards);
+  for (BaseCommand *Cmd : Commands) {
+    auto *ISD = dyn_cast<InputSectionDescription>(Cmd);
+    if (!ISD)
+      continue;
+    for (InputSection *IS : ISD->Sections) {
+      uint64_t Size = IS->getSize();
+      if (!IS->Live || Size == 0)
+        continue;
+      size_t First = IS->OutSecOff / ShardSize;
+      size_t Last = (IS->OutSecOff + Size - 1) / ShardSize;
+      if (First != Last)
+        Straddling.push_back(IS);
+      for (size_t I = First; I <= Last; ++I)
+        ShardSections[I].push_back(IS);
+    }
+  }
+
+  // Write straddling sections to their own buffers.
+  DenseMap<InputSection *, size_t> StraddlingIndex;
+  for (size_t I = 0, E = Straddling.size(); I != E; ++I)
+    StraddlingIndex[Straddling[I]] = I;
+  std::vector<std::vector<uint8_t>> StraddlingBufs(Straddling.size());
+  parallelForEachN(0, Straddling.size(), [&](size_t I) {
+    InputSection *IS = Straddling[I];
+    StraddlingBufs[I].resize(IS->getSize());
+    IS->writeTo<ELFT>(StraddlingBufs[I].data() - IS->OutSecOff);
+  });
+
+  // Writes the contents of [Begin, End) of this section to a given buffer.
+  uint32_t Filler = getFiller();
+  auto WriteShard = [&](size_t I, MutableArrayRef<uint8_t> Buf) {
+    uint64_t Begin = I * ShardSize;
+    uint64_t End = Begin + Buf.size();
+    if (Filler)
+      fill(Buf.data(), Buf.size(), Filler);
+
+    // Input sections write themselves at Base + OutSecOff.
+    uint8_t *Base = Buf.data() - Begin;
+    for (InputSection *IS : ShardSections[I]) {
+      auto It = StraddlingIndex.find(IS);
+      if (It == StraddlingIndex.end()) {
+        IS->writeTo<ELFT>(Base);
+        continue;
+      }
+      uint64_t From = std::max<uint64_t>(Begin, IS->OutSecOff);
+      uint64_t To = std::min<uint64_t>(End, IS->OutSecOff + IS->getSize());
+      uint8_t *Src = StraddlingBufs[It->second].data() - IS->OutSecOff;
+      memcpy(Base + From, Src + From, To - From);
+    }
+
+    for (BaseCommand *Cmd : Commands) {
+      auto *Data = dyn_cast<BytesDataCommand>(Cmd);
+      if (!Data || Data->Offset >= End || Data->Offset + Data->Size <= Begin)
+        continue;
+      uint8_t Tmp[8];
+      writeInt(Tmp, Data->Expression().getValue(), Data->Size);
+      uint64_t From = std::max<uint64_t>(Begin, Data->Offset);
+      uint64_t To = std::min<uint64_t>(End, Data->Offset + Data->Size);
+      memcpy(Base + From, Tmp + From - Data->Offset, To - From);
+    }
+  };
+
+  std::vector<std::vector<uint8_t>> Shards(NumShards);
+
+#ifdef LLD_HAS_ZLIB
+  std::vector<uint32_t> Checksums(NumShards);
+  parallelForEachN(0, NumShards, [&](size_t I) {
+    uint64_t Begin = I * ShardSize;
+    std::vector<uint8_t> Buf(std::min(ShardSize, Sec->Size - Begin));
+    WriteShard(I, Buf);
+
+    // The first shard begins with a zlib header. We use the fastest
+    // compression level in the header. The field is informational and
+    // doesn't affect decompression.
+    Shards[I] = deflateShard(Buf, I == 0 ? 2 : 0, I + 1 == NumShards);
+    if (I == 0) {
+      Shards[I][0] = 0x78;
+      Shards[I][1] = 0x01;
+    }
+    Checksums[I] = adler32(1, Buf.data(), Buf.size());
+  });
+
+  // Append the Adler-32 checksum of the uncompressed data.
+  uint32_t Checksum = Checksums[0];
+  for (size_t I = 1; I != NumShards; ++I)
+    Checksum = adler32_combine(
+        Checksum, Checksums[I],
+        std::min(ShardSize, Sec->Size - I * ShardSize));
+  uint8_t Trailer[4];
+  write32be(Trailer, Checksum);
+  Shards.back().insert(Shards.back().end(), Trailer, Trailer + 4);
+#else
   std::vector<uint8_t> Buf(Sec->Size);
-  writeTo<ELFT>(Buf.data());
-  if (Error E = zlib::compress(toStringRef(Buf), Sec->CompressedData))
+  WriteShard(0, Buf);
+  SmallVector<char, 0> Out;
+  if (Error E = zlib::compress(toStringRef(Buf), Out, getCompressionLevel()))
     fatal("compress failed: " + llvm::toString(std::move(E)));
+  Shards[0].assign(Out.begin(), Out.end());
+#endif
 
   // Update section headers.
-  Sec->Size = sizeof(Elf_Chdr) + Sec->CompressedData.size();
+  Sec->Size = sizeof(Elf_Chdr);
+  for (std::vector<uint8_t> &Shard : Shards)
+    Sec->Size += Shard.size();
+  Sec->CompressedShards = std::move(Shards);
   Sec->Flags |= SHF_COMPRESSED;
 }
 
@@ -1048,10 +1307,13 @@ template <class ELFT> void OutputSectionCommand::writeTo(uint8_t *Buf) {
   // If -compress-debug-section is specified and if this is a debug seciton,
   // we've already compressed section contents. If that's the case,
   // just write it down.
-  if (!Sec->CompressedData.empty()) {
+  if (!Sec->CompressedShards.empty()) {
     memcpy(Buf, Sec->ZDebugHeader.data(), Sec->ZDebugHeader.size());
-    memcpy(Buf + Sec->ZDebugHeader.size(), Sec->CompressedData.data(),
-           Sec->CompressedData.size());
+    Buf += Sec->ZDebugHeader.size();
+    for (const std::vector<uint8_t> &Shard : Sec->CompressedShards) {
+      memcpy(Buf, Shard.data(), Shard.size());
+      Buf += Shard.size();
+    }
     return;
   }
 
@@ -221,6 +221,24 @@ struct ScriptConfiguration {
   std::vector<llvm::StringRef> ReferencedSymbols;
 };
 
+// An index of input sections used to assign them to output sections.
+// Linker scripts may have hundreds of section patterns, and there may be
+// millions of input sections, so we don't want to visit all input sections
+// for each pattern. With this index, we visit only sections whose names
+// or file names may match a given pattern.
+struct InputSectionIndex {
+  // Candidate sections for assignment in the original order, and their
+  // file names. Other data members refer to them by position.
+  std::vector<InputSectionBase *> Sections;
+  std::vector<StringRef> Filenames;
+
+  llvm::DenseMap<StringRef, std::vector<uint32_t>> ByName;
+  llvm::DenseMap<StringRef, std::vector<uint32_t>> ByFilename;
+
+  // Section names and positions sorted by name for prefix lookups.
+  std::vector<std::pair<StringRef, uint32_t>> SortedNames;
+};
+
 class LinkerScript final {
   llvm::DenseMap<OutputSection *, OutputSectionCommand *> SecToCommand;
   llvm::DenseMap<StringRef, OutputSectionCommand *> NameToOutputSectionCommand;
@@ -228,6 +246,9 @@ class LinkerScript final {
   void assignSymbol(SymbolAssignment *Cmd, bool InSec);
   void setDot(Expr E, const Twine &Loc, bool InSec);
 
+  void buildInputSectionIndex();
+  std::vector<uint32_t> getCandidates(const InputSectionDescription *Cmd,
+                                      const SectionPattern &Pat);
   std::vector<InputSection *>
   computeInputSections(const InputSectionDescription *);
 
@@ -253,6 +274,9 @@ class LinkerScript final {
   OutputSection *CurOutSec = nullptr;
   MemoryRegion *CurMemRegion = nullptr;
 
+  // Valid only during processCommands().
+  InputSectionIndex Index;
+
 public:
   bool ErrorOnMissingSection = false;
   OutputSectionCommand *createOutputSectionCommand(StringRef Name,
@@ -281,6 +305,7 @@ public:
   void assignOffsets(OutputSectionCommand *Cmd);
   void createOrphanCommands();
   void processNonSectionCommands();
+  void assignAddresses();
   void assignAddresses(std::vector<PhdrEntry> &Phdrs);
 
   void addSymbol(SymbolAssignment *Cmd);
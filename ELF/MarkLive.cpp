@@ -28,6 +28,8 @@
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "Target.h"
+#include "Threads.h"
+#include "Timer.h"
 #include "Writer.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Object/ELF.h"
@@ -185,24 +187,69 @@ template <class ELFT> static bool isReserved(InputSectionBase *Sec) {
   }
 }
 
+// Visits all sections reachable from Roots and sets their Live bits.
+//
+// This is a parallel graph traversal. Each task takes a part of the
+// current frontier and visits sections depth-first until it has visited
+// a certain number of sections. Sections left on its stack are handed
+// to the next round, so that a task that found a large subgraph shares
+// the work with other threads instead of doing it alone. Since a section
+// becomes live by atomically setting its Live bit, each section is
+// visited exactly once, and the resulting live set doesn't depend on the
+// order of visits.
+template <class ELFT>
+static void markReachable(std::vector<InputSection *> Roots,
+                          std::function<bool(ResolvedReloc)> Mark) {
+  const size_t TaskSize = 1024;
+
+  std::vector<InputSection *> Frontier = std::move(Roots);
+  while (!Frontier.empty()) {
+    size_t NumTasks = (Frontier.size() + TaskSize - 1) / TaskSize;
+    std::vector<std::vector<InputSection *>> Leftovers(NumTasks);
+
+    parallelForEachN(0, NumTasks, [&](size_t I) {
+      size_t Begin = I * TaskSize;
+      size_t End = std::min(Begin + TaskSize, Frontier.size());
+      std::vector<InputSection *> &Stack = Leftovers[I];
+      Stack.assign(Frontier.begin() + Begin, Frontier.begin() + End);
+
+      for (size_t N = 0; N < TaskSize && !Stack.empty(); ++N)
+        forEachSuccessor<ELFT>(*Stack.pop_back_val(), [&](ResolvedReloc R) {
+          if (Mark(R))
+            if (auto *S = dyn_cast<InputSection>(R.Sec))
+              Stack.push_back(S);
+        });
+    });
+
+    Frontier.clear();
+    for (std::vector<InputSection *> &V : Leftovers)
+      Frontier.insert(Frontier.end(), V.begin(), V.end());
+  }
+}
+
+static Timer MarkLiveTimer("Mark live", Timer::root());
+
 // This is the main function of the garbage collector.
 // Starting from GC-root sections, this function visits all reachable
 // sections to set their "Live" bits.
 template <class ELFT> void elf::markLive() {
-  SmallVector<InputSection *, 256> Q;
+  ScopedTimer T(MarkLiveTimer);
+  std::vector<InputSection *> Q;
   CNamedSections.clear();
 
-  auto Enqueue = [&](ResolvedReloc R) {
+  // Marks a given section live. Returns true if the section was not live
+  // before. This function is called from multiple threads.
+  auto Mark = [](ResolvedReloc R) {
     // Skip over discarded sections. This in theory shouldn't happen, because
     // the ELF spec doesn't allow a relocation to point to a deduplicated
     // COMDAT section directly. Unfortunately this happens in practice (e.g.
     // .eh_frame) so we need to add a check.
     if (R.Sec == &InputSection::Discarded)
-      return;
+      return false;
 
     // We don't gc non alloc sections.
     if (!(R.Sec->Flags & SHF_ALLOC))
-      return;
+      return false;
 
     // Usually, a whole section is marked as live or dead, but in mergeable
     // (splittable) sections, each piece of data has independent liveness bit.
@@ -210,9 +257,12 @@ template <class ELFT> void elf::markLive() {
     if (auto *MS = dyn_cast<MergeInputSection>(R.Sec))
       MS->markLiveAt(R.Offset);
 
-    if (R.Sec->Live)
+    return !R.Sec->Live.exchange(true);
+  };
+
+  auto Enqueue = [&](ResolvedReloc R) {
+    if (!Mark(R))
       return;
-    R.Sec->Live = true;
     // Add input section to the queue.
     if (InputSection *S = dyn_cast<InputSection>(R.Sec))
       Q.push_back(S);
@@ -258,8 +308,7 @@ template <class ELFT> void elf::markLive() {
   }
 
   // Mark all reachable sections.
-  while (!Q.empty())
-    forEachSuccessor<ELFT>(*Q.pop_back_val(), Enqueue);
+  markReachable<ELFT>(std::move(Q), Mark);
 }
 
 template void elf::markLive<ELF32LE>();
@@ -25,23 +25,25 @@
 #define LLD_ELF_MEMORY_H
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/StringSaver.h"
+#include <mutex>
 #include <vector>
 
 namespace lld {
 namespace elf {
 
-// Use this arena if your object doesn't have a destructor.
-extern llvm::BumpPtrAllocator BAlloc;
-extern llvm::StringSaver Saver;
-
 // These two classes are hack to keep track of all
 // SpecificBumpPtrAllocator instances.
 struct SpecificAllocBase {
-  SpecificAllocBase() { Instances.push_back(this); }
+  SpecificAllocBase() {
+    std::lock_guard<std::mutex> Lock(Mu);
+    Instances.push_back(this);
+  }
   virtual ~SpecificAllocBase() = default;
   virtual void reset() = 0;
   static std::vector<SpecificAllocBase *> Instances;
+  static std::mutex Mu;
 };
 
 template <class T> struct SpecificAlloc : public SpecificAllocBase {
@@ -49,17 +51,69 @@ template <class T> struct SpecificAlloc : public SpecificAllocBase {
   llvm::SpecificBumpPtrAllocator<T> Alloc;
 };
 
+// A BumpPtrAllocator and a StringSaver for each thread. Like SpecificAlloc,
+// they are registered to SpecificAllocBase::Instances, so they are reset
+// by freeArena() and memory allocated by a thread outlives the thread.
+struct ThreadArena : public SpecificAllocBase {
+  ThreadArena() : Saver(Alloc) {}
+  void reset() override { Alloc.Reset(); }
+  llvm::BumpPtrAllocator Alloc;
+  llvm::StringSaver Saver;
+};
+
+inline ThreadArena &getThreadArena() {
+  static LLVM_THREAD_LOCAL ThreadArena *Arena = nullptr;
+  if (!Arena)
+    Arena = new ThreadArena;
+  return *Arena;
+}
+
+// Thread-safe versions of BumpPtrAllocator and StringSaver. They have no
+// state and forward all requests to the current thread's arena.
+struct ThreadSafeAllocator {
+  void *Allocate(size_t Size, size_t Alignment) {
+    return getThreadArena().Alloc.Allocate(Size, Alignment);
+  }
+  template <typename T> T *Allocate(size_t Num = 1) {
+    return getThreadArena().Alloc.Allocate<T>(Num);
+  }
+};
+
+struct ThreadSafeSaver {
+  llvm::StringRef save(const char *S) { return get().save(S); }
+  llvm::StringRef save(llvm::StringRef S) { return get().save(S); }
+  llvm::StringRef save(const llvm::Twine &S) { return get().save(S); }
+  llvm::StringRef save(const std::string &S) {
+    return get().save(llvm::StringRef(S));
+  }
+
+  // For APIs that take a StringSaver. The returned object must not be
+  // passed to other threads.
+  llvm::StringSaver &get() { return getThreadArena().Saver; }
+};
+
+// Use these arenas if your object doesn't have a destructor.
+// Like make(), they can be used from parallelForEach.
+extern ThreadSafeAllocator BAlloc;
+extern ThreadSafeSaver Saver;
+
 // Use this arena if your object has a destructor.
 // Your destructor will be invoked from freeArena().
+//
+// Each thread has its own arena for each type, so that make() can be
+// called from parallelForEach without locking. Arenas are not owned by
+// threads but by Instances, so objects outlive the threads that
+// created them.
 template <typename T, typename... U> T *make(U &&... Args) {
-  static SpecificAlloc<T> Alloc;
-  return new (Alloc.Alloc.Allocate()) T(std::forward<U>(Args)...);
+  static LLVM_THREAD_LOCAL SpecificAlloc<T> *Alloc = nullptr;
+  if (!Alloc)
+    Alloc = new SpecificAlloc<T>;
+  return new (Alloc->Alloc.Allocate()) T(std::forward<U>(Args)...);
 }
 
 inline void freeArena() {
   for (SpecificAllocBase *Alloc : SpecificAllocBase::Instances)
     Alloc->reset();
-  BAlloc.Reset();
 }
 }
 }
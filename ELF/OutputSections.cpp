@@ -101,6 +101,14 @@ void OutputSection::addSection(InputSection *S) {
   this->Entsize = std::max(this->Entsize, S->Entsize);
 }
 
+// Recomputes the approximate offsets computed by addSection(). This is
+// needed if the size of an input section changes after it is added.
+void OutputSection::updateOffsets() {
+  this->Size = 0;
+  for (InputSection *S : Sections)
+    this->Size = updateOffset(Size, S);
+}
+
 // This function is called after we sort input sections
 // and scan relocations to setup sections' offsets.
 void OutputSection::assignOffsets() {
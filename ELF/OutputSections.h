@@ -80,6 +80,7 @@ public:
   uint32_t ShName = 0;
 
   void addSection(InputSection *S);
+  void updateOffsets();
   void sort(std::function<int(InputSectionBase *S)> Order);
   void sortInitFini();
   void sortCtorsDtors();
@@ -87,8 +88,9 @@ public:
   std::vector<InputSection *> Sections;
 
   // Used for implementation of --compress-debug-sections option.
+  // Concatenation of CompressedShards is a single zlib stream.
   std::vector<uint8_t> ZDebugHeader;
-  llvm::SmallVector<char, 1> CompressedData;
+  std::vector<std::vector<uint8_t>> CompressedShards;
 
   // Location in the output buffer.
   uint8_t *Loc = nullptr;
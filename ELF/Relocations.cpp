@@ -50,6 +50,7 @@
 #include "SymbolTable.h"
 #include "SyntheticSections.h"
 #include "Target.h"
+#include "Threads.h"
 #include "Thunks.h"
 
 #include "llvm/Support/Endian.h"
@@ -449,23 +450,9 @@ template <class ELFT> static bool isReadOnly(SharedSymbol *SS) {
 // them are copied by a copy relocation, all of them need to be copied.
 // Otherwise, they would refer different places at runtime.
 template <class ELFT>
-static std::vector<SharedSymbol *> getSymbolsAt(SharedSymbol *SS) {
-  typedef typename ELFT::Sym Elf_Sym;
-
+static ArrayRef<SharedSymbol *> getSymbolsAt(SharedSymbol *SS) {
   auto *File = cast<SharedFile<ELFT>>(SS->File);
-  uint64_t Shndx = SS->getShndx<ELFT>();
-  uint64_t Value = SS->getValue<ELFT>();
-
-  std::vector<SharedSymbol *> Ret;
-  for (const Elf_Sym &S : File->getGlobalSymbols()) {
-    if (S.st_shndx != Shndx || S.st_value != Value)
-      continue;
-    StringRef Name = check(S.getName(File->getStringTable()));
-    SymbolBody *Sym = Symtab<ELFT>::X->find(Name);
-    if (auto *Alias = dyn_cast_or_null<SharedSymbol>(Sym))
-      Ret.push_back(Alias);
-  }
-  return Ret;
+  return File->getSymbolsAt(SS->getShndx<ELFT>(), SS->getValue<ELFT>());
 }
 
 // Reserve space in .bss or .bss.rel.ro for copy relocation.
@@ -773,6 +760,23 @@ static void addPltEntry(PltSection *Plt, GotPltSection *GotPlt,
   Rel->addReloc({Type, GotPlt, Sym.getGotPltOffset(), UseSymVA, &Sym, 0});
 }
 
+// Adds a relative dynamic relocation for the location at Offset in Sec.
+// With --pack-dyn-relocs=relr, it is added to .relr.dyn unless the
+// location is at an odd address. Returns true in that case. Because
+// .relr.dyn has no addends, the caller then has to write the addend to
+// the location as it would for Elf_Rel.
+template <class ELFT>
+static bool addRelativeReloc(InputSectionBase *Sec, uint64_t Offset,
+                             SymbolBody *Body, int64_t Addend) {
+  if (In<ELFT>::RelrDyn && Sec->Alignment >= 2 && Offset % 2 == 0) {
+    In<ELFT>::RelrDyn->addReloc(Sec, Offset);
+    return true;
+  }
+  In<ELFT>::RelaDyn->addReloc(
+      {Target->RelativeRel, Sec, Offset, true, Body, Addend});
+  return false;
+}
+
 template <class ELFT>
 static void addGotEntry(SymbolBody &Sym, bool Preemptible) {
   InX::Got->addEntry(Sym);
@@ -791,197 +795,370 @@ static void addGotEntry(SymbolBody &Sym, bool Preemptible) {
   }
 
   bool Constant = !Preemptible && !(Config->Pic && !isAbsolute(Sym));
-  if (!Constant)
-    In<ELFT>::RelaDyn->addReloc(
-        {DynType, InX::Got, Off, !Preemptible, &Sym, 0});
+  bool Packed = false;
+  if (!Constant) {
+    if (DynType == Target->RelativeRel)
+      Packed = addRelativeReloc<ELFT>(InX::Got, Off, &Sym, 0);
+    else
+      In<ELFT>::RelaDyn->addReloc(
+          {DynType, InX::Got, Off, !Preemptible, &Sym, 0});
+  }
 
-  if (Constant || (!Config->IsRela && !Preemptible))
+  // A GOT entry of a packed relative relocation holds the symbol's
+  // address. RELA targets don't know how to apply R_*_RELATIVE, so we
+  // use the GLOB_DAT type to write it.
+  if (Packed && Config->IsRela)
+    DynType = Target->GotRel;
+  if (Constant || Packed || (!Config->IsRela && !Preemptible))
     InX::Got->Relocations.push_back({Expr, DynType, Off, 0, &Sym});
 }
 
-// The reason we have to do this early scan is as follows
-// * To mmap the output file, we need to know the size
-// * For that, we need to know how many dynamic relocs we will have.
-// It might be possible to avoid this by outputting the file with write:
-// * Write the allocated output sections, computing addresses.
-// * Apply relocations, recording which ones require a dynamic reloc.
-// * Write the dynamic relocations.
-// * Write the rest of the file.
-// This would have some drawbacks. For example, we would only know if .rela.dyn
-// is needed after applying relocations. If it is, it will go after rw and rx
-// sections. Given that it is ro, we will need an extra PT_LOAD. This
-// complicates things for the dynamic linker and means we would have to reserve
-// space for the extra PT_LOAD even if we end up not using it.
+namespace {
+// The result of the parallel part of relocation scanning. If Deferred is
+// true, the relocation is handled by the serial part from scratch.
+// Otherwise, the other flags describe what the serial part has to do.
+struct ScannedReloc {
+  SymbolBody *Body;
+  uint64_t Offset;
+  int64_t Addend;
+  uint32_t Type;
+  uint32_t Index; // Index in the relocation section.
+  RelExpr Expr;
+  unsigned Deferred : 1;
+  unsigned HasGotOffRel : 1;
+  unsigned NeedsGot : 1;
+  unsigned NeedsDynRel : 1;
+  unsigned NeedsRel : 1;
+};
+} // namespace
+
+// Computes what needs to be done for a relocation if it can be done
+// without looking at or modifying global state, such as GOT or PLT.
+// That is true only for relocations against non-preemptible regular
+// symbols. Relocations against shared symbols can change preemptibility
+// of the symbols by creating copy relocations or canonical PLT entries,
+// so they have to be handled in order. TLS, IFunc and MIPS relocations
+// are relatively rare, and they are also left to the serial part.
+template <class ELFT, class RelTy>
+static void preScanReloc(InputSectionBase &Sec, const RelTy &Rel,
+                         ScannedReloc &R) {
+  R.Deferred = true;
+  SymbolBody &Body = *R.Body;
+  auto *D = dyn_cast<DefinedRegular>(&Body);
+  if (!D || (D->File && !isa<ObjectFile<ELFT>>(D->File)) || D->isTls() ||
+      D->isGnuIFunc() || Config->EMachine == EM_MIPS ||
+      isPreemptible(Body, R.Type))
+    return;
+
+  // If we would report something, we give up and let the serial
+  // part report it.
+  DiagnosticSuppressor DS;
+  RelExpr Expr =
+      Target->getRelExpr(R.Type, Body, Sec.Data.begin() + Rel.r_offset);
+  if (!isRelExprOneOf<R_HINT, R_NONE>(Expr)) {
+    Expr = adjustExpr<ELFT>(Body, Expr, R.Type, Sec.Data.data() + Rel.r_offset,
+                            Sec, Rel.r_offset);
+    if (needsPlt(Expr))
+      return;
+    bool IsConstant =
+        isStaticLinkTimeConstant<ELFT>(Expr, R.Type, Body, Sec, Rel.r_offset);
+    if (Expr == R_SIZE)
+      R.Addend += Body.getSize<ELFT>();
+
+    R.HasGotOffRel = isRelExprOneOf<R_GOTONLY_PC, R_GOTONLY_PC_FROM_END,
+                                    R_GOTREL, R_GOTREL_FROM_END, R_PPC_TOC>(
+        Expr);
+    R.NeedsGot = needsGot(Expr);
+    R.NeedsDynRel = !IsConstant;
+    R.NeedsRel = IsConstant || !RelTy::IsRela;
+  }
+  R.Expr = Expr;
+  R.Deferred = DS.hasDiagnostics();
+}
+
+// Decodes relocations of a given section and handles as many of them as
+// possible. This function is called for sections in parallel.
 template <class ELFT, class RelTy>
-static void scanRelocs(InputSectionBase &Sec, ArrayRef<RelTy> Rels) {
+static std::vector<ScannedReloc> preScanRelocs(InputSectionBase &Sec,
+                                               ArrayRef<RelTy> Rels) {
+  std::vector<ScannedReloc> Ret;
+  Ret.reserve(Rels.size());
   OffsetGetter GetOffset(Sec);
 
   for (auto I = Rels.begin(), End = Rels.end(); I != End; ++I) {
     const RelTy &Rel = *I;
-    SymbolBody &Body = Sec.getFile<ELFT>()->getRelocTargetSym(Rel);
-    uint32_t Type = Rel.getType(Config->IsMips64EL);
+    ScannedReloc R = {};
+    R.Body = &Sec.getFile<ELFT>()->getRelocTargetSym(Rel);
+    R.Type = Rel.getType(Config->IsMips64EL);
+    R.Index = I - Rels.begin();
 
     if (Config->MipsN32Abi) {
       uint32_t Processed;
-      std::tie(Type, Processed) =
-          mergeMipsN32RelTypes(Type, Rel.r_offset, I + 1, End);
+      std::tie(R.Type, Processed) =
+          mergeMipsN32RelTypes(R.Type, Rel.r_offset, I + 1, End);
       I += Processed;
     }
 
     // Compute the offset of this section in the output section.
-    uint64_t Offset = GetOffset.get(Rel.r_offset);
-    if (Offset == uint64_t(-1))
+    R.Offset = GetOffset.get(Rel.r_offset);
+    if (R.Offset == uint64_t(-1))
       continue;
 
-    // Report undefined symbols. The fact that we report undefined
-    // symbols here means that we report undefined symbols only when
-    // they have relocations pointing to them. We don't care about
-    // undefined symbols that are in dead-stripped sections.
-    if (!Body.isLocal() && Body.isUndefined() && !Body.symbol()->isWeak())
-      reportUndefined<ELFT>(Body, Sec, Rel.r_offset);
-
-    RelExpr Expr =
-        Target->getRelExpr(Type, Body, Sec.Data.begin() + Rel.r_offset);
+    // Read an addend.
+    R.Addend = computeAddend<ELFT>(Rel, Sec.Data.data());
+    preScanReloc<ELFT>(Sec, Rel, R);
+    Ret.push_back(R);
+  }
+  return Ret;
+}
 
-    // Ignore "hint" relocations because they are only markers for relaxation.
-    if (isRelExprOneOf<R_HINT, R_NONE>(Expr))
-      continue;
+// Handles a relocation that was not handled by preScanReloc.
+// Returns the number of relocations consumed.
+template <class ELFT, class RelTy>
+static unsigned scanReloc(InputSectionBase &Sec, ArrayRef<RelTy> Rels,
+                          const ScannedReloc &R) {
+  const RelTy &Rel = Rels[R.Index];
+  SymbolBody &Body = *R.Body;
+  uint32_t Type = R.Type;
+  uint64_t Offset = R.Offset;
+
+  // Report undefined symbols. The fact that we report undefined
+  // symbols here means that we report undefined symbols only when
+  // they have relocations pointing to them. We don't care about
+  // undefined symbols that are in dead-stripped sections.
+  if (!Body.isLocal() && Body.isUndefined() && !Body.symbol()->isWeak())
+    reportUndefined<ELFT>(Body, Sec, Rel.r_offset);
+
+  RelExpr Expr =
+      Target->getRelExpr(Type, Body, Sec.Data.begin() + Rel.r_offset);
+
+  // Ignore "hint" relocations because they are only markers for relaxation.
+  if (isRelExprOneOf<R_HINT, R_NONE>(Expr))
+    return 1;
 
-    bool Preemptible = isPreemptible(Body, Type);
-    Expr = adjustExpr<ELFT>(Body, Expr, Type, Sec.Data.data() + Rel.r_offset,
-                            Sec, Rel.r_offset);
-    if (ErrorCount)
-      continue;
+  bool Preemptible = isPreemptible(Body, Type);
+  Expr = adjustExpr<ELFT>(Body, Expr, Type, Sec.Data.data() + Rel.r_offset,
+                          Sec, Rel.r_offset);
+  if (ErrorCount)
+    return 1;
 
-    // This relocation does not require got entry, but it is relative to got and
-    // needs it to be created. Here we request for that.
-    if (isRelExprOneOf<R_GOTONLY_PC, R_GOTONLY_PC_FROM_END, R_GOTREL,
-                       R_GOTREL_FROM_END, R_PPC_TOC>(Expr))
-      InX::Got->HasGotOffRel = true;
+  // This relocation does not require got entry, but it is relative to got and
+  // needs it to be created. Here we request for that.
+  if (isRelExprOneOf<R_GOTONLY_PC, R_GOTONLY_PC_FROM_END, R_GOTREL,
+                     R_GOTREL_FROM_END, R_PPC_TOC>(Expr))
+    InX::Got->HasGotOffRel = true;
 
-    // Read an addend.
-    int64_t Addend = computeAddend<ELFT>(Rel, Sec.Data.data());
-    if (Config->EMachine == EM_MIPS)
-      Addend += computeMipsAddend<ELFT>(Rel, Sec, Expr, Body, End);
+  int64_t Addend = R.Addend;
+  if (Config->EMachine == EM_MIPS)
+    Addend += computeMipsAddend<ELFT>(Rel, Sec, Expr, Body, Rels.end());
+
+  // Process some TLS relocations, including relaxing TLS relocations.
+  // Note that this function does not handle all TLS relocations.
+  if (unsigned Processed =
+          handleTlsRelocation<ELFT>(Type, Body, Sec, Offset, Addend, Expr))
+    return Processed;
+
+  // If a relocation needs PLT, we create PLT and GOTPLT slots for the symbol.
+  if (needsPlt(Expr) && !Body.isInPlt()) {
+    if (Body.isGnuIFunc() && !Preemptible)
+      addPltEntry(InX::Iplt, InX::IgotPlt, In<ELFT>::RelaIplt,
+                  Target->IRelativeRel, Body, true);
+    else
+      addPltEntry(InX::Plt, InX::GotPlt, In<ELFT>::RelaPlt, Target->PltRel,
+                  Body, !Preemptible);
+  }
 
-    // Process some TLS relocations, including relaxing TLS relocations.
-    // Note that this function does not handle all TLS relocations.
-    if (unsigned Processed =
-            handleTlsRelocation<ELFT>(Type, Body, Sec, Offset, Addend, Expr)) {
-      I += (Processed - 1);
-      continue;
+  // Create a GOT slot if a relocation needs GOT.
+  if (needsGot(Expr)) {
+    if (Config->EMachine == EM_MIPS) {
+      // MIPS ABI has special rules to process GOT entries and doesn't
+      // require relocation entries for them. A special case is TLS
+      // relocations. In that case dynamic loader applies dynamic
+      // relocations to initialize TLS GOT entries.
+      // See "Global Offset Table" in Chapter 5 in the following document
+      // for detailed description:
+      // ftp://www.linux-mips.org/pub/linux/mips/doc/ABI/mipsabi.pdf
+      InX::MipsGot->addEntry(Body, Addend, Expr);
+      if (Body.isTls() && Body.isPreemptible())
+        In<ELFT>::RelaDyn->addReloc({Target->TlsGotRel, InX::MipsGot,
+                                     Body.getGotOffset(), false, &Body, 0});
+    } else if (!Body.isInGot()) {
+      addGotEntry<ELFT>(Body, Preemptible);
     }
+  }
 
-    // If a relocation needs PLT, we create PLT and GOTPLT slots for the symbol.
-    if (needsPlt(Expr) && !Body.isInPlt()) {
-      if (Body.isGnuIFunc() && !Preemptible)
-        addPltEntry(InX::Iplt, InX::IgotPlt, In<ELFT>::RelaIplt,
-                    Target->IRelativeRel, Body, true);
-      else
-        addPltEntry(InX::Plt, InX::GotPlt, In<ELFT>::RelaPlt, Target->PltRel,
-                    Body, !Preemptible);
-    }
+  if (!needsPlt(Expr) && !needsGot(Expr) && isPreemptible(Body, Type)) {
+    // We don't know anything about the finaly symbol. Just ask the dynamic
+    // linker to handle the relocation for us.
+    if (!Target->isPicRel(Type))
+      error("relocation " + toString(Type) +
+            " cannot be used against shared object; recompile with -fPIC" +
+            getLocation<ELFT>(Sec, Body, Offset));
 
-    // Create a GOT slot if a relocation needs GOT.
-    if (needsGot(Expr)) {
-      if (Config->EMachine == EM_MIPS) {
-        // MIPS ABI has special rules to process GOT entries and doesn't
-        // require relocation entries for them. A special case is TLS
-        // relocations. In that case dynamic loader applies dynamic
-        // relocations to initialize TLS GOT entries.
-        // See "Global Offset Table" in Chapter 5 in the following document
-        // for detailed description:
-        // ftp://www.linux-mips.org/pub/linux/mips/doc/ABI/mipsabi.pdf
-        InX::MipsGot->addEntry(Body, Addend, Expr);
-        if (Body.isTls() && Body.isPreemptible())
-          In<ELFT>::RelaDyn->addReloc({Target->TlsGotRel, InX::MipsGot,
-                                       Body.getGotOffset(), false, &Body, 0});
-      } else if (!Body.isInGot()) {
-        addGotEntry<ELFT>(Body, Preemptible);
-      }
-    }
+    In<ELFT>::RelaDyn->addReloc(
+        {Target->getDynRel(Type), &Sec, Offset, false, &Body, Addend});
+
+    // MIPS ABI turns using of GOT and dynamic relocations inside out.
+    // While regular ABI uses dynamic relocations to fill up GOT entries
+    // MIPS ABI requires dynamic linker to fills up GOT entries using
+    // specially sorted dynamic symbol table. This affects even dynamic
+    // relocations against symbols which do not require GOT entries
+    // creation explicitly, i.e. do not have any GOT-relocations. So if
+    // a preemptible symbol has a dynamic relocation we anyway have
+    // to create a GOT entry for it.
+    // If a non-preemptible symbol has a dynamic relocation against it,
+    // dynamic linker takes it st_value, adds offset and writes down
+    // result of the dynamic relocation. In case of preemptible symbol
+    // dynamic linker performs symbol resolution, writes the symbol value
+    // to the GOT entry and reads the GOT entry when it needs to perform
+    // a dynamic relocation.
+    // ftp://www.linux-mips.org/pub/linux/mips/doc/ABI/mipsabi.pdf p.4-19
+    if (Config->EMachine == EM_MIPS)
+      InX::MipsGot->addEntry(Body, Addend, Expr);
+    return 1;
+  }
 
-    if (!needsPlt(Expr) && !needsGot(Expr) && isPreemptible(Body, Type)) {
-      // We don't know anything about the finaly symbol. Just ask the dynamic
-      // linker to handle the relocation for us.
-      if (!Target->isPicRel(Type))
-        error("relocation " + toString(Type) +
-              " cannot be used against shared object; recompile with -fPIC" +
-              getLocation<ELFT>(Sec, Body, Offset));
+  // If the relocation points to something in the file, we can process it.
+  bool IsConstant =
+      isStaticLinkTimeConstant<ELFT>(Expr, Type, Body, Sec, Rel.r_offset);
+
+  // The size is not going to change, so we fold it in here.
+  if (Expr == R_SIZE)
+    Addend += Body.getSize<ELFT>();
+
+  // If the output being produced is position independent, the final value
+  // is still not known. In that case we still need some help from the
+  // dynamic linker. We can however do better than just copying the incoming
+  // relocation. We can process some of it and and just ask the dynamic
+  // linker to add the load address.
+  bool Packed =
+      !IsConstant && addRelativeReloc<ELFT>(&Sec, Offset, &Body, Addend);
+
+  // If the produced value is a constant, we just remember to write it
+  // when outputting this section. We also have to do it if the format
+  // uses Elf_Rel or the relocation was packed into .relr.dyn, since in
+  // that case the written value is the addend.
+  if (IsConstant || Packed || !RelTy::IsRela)
+    Sec.Relocations.push_back({Expr, Type, Offset, Addend, &Body});
+  return 1;
+}
 
-      In<ELFT>::RelaDyn->addReloc(
-          {Target->getDynRel(Type), &Sec, Offset, false, &Body, Addend});
-
-      // MIPS ABI turns using of GOT and dynamic relocations inside out.
-      // While regular ABI uses dynamic relocations to fill up GOT entries
-      // MIPS ABI requires dynamic linker to fills up GOT entries using
-      // specially sorted dynamic symbol table. This affects even dynamic
-      // relocations against symbols which do not require GOT entries
-      // creation explicitly, i.e. do not have any GOT-relocations. So if
-      // a preemptible symbol has a dynamic relocation we anyway have
-      // to create a GOT entry for it.
-      // If a non-preemptible symbol has a dynamic relocation against it,
-      // dynamic linker takes it st_value, adds offset and writes down
-      // result of the dynamic relocation. In case of preemptible symbol
-      // dynamic linker performs symbol resolution, writes the symbol value
-      // to the GOT entry and reads the GOT entry when it needs to perform
-      // a dynamic relocation.
-      // ftp://www.linux-mips.org/pub/linux/mips/doc/ABI/mipsabi.pdf p.4-19
-      if (Config->EMachine == EM_MIPS)
-        InX::MipsGot->addEntry(Body, Addend, Expr);
+// The reason we have to do this early scan is as follows
+// * To mmap the output file, we need to know the size
+// * For that, we need to know how many dynamic relocs we will have.
+// It might be possible to avoid this by outputting the file with write:
+// * Write the allocated output sections, computing addresses.
+// * Apply relocations, recording which ones require a dynamic reloc.
+// * Write the dynamic relocations.
+// * Write the rest of the file.
+// This would have some drawbacks. For example, we would only know if .rela.dyn
+// is needed after applying relocations. If it is, it will go after rw and rx
+// sections. Given that it is ro, we will need an extra PT_LOAD. This
+// complicates things for the dynamic linker and means we would have to reserve
+// space for the extra PT_LOAD even if we end up not using it.
+//
+// This function applies the results of preScanRelocs in input order,
+// so GOT, PLT and dynamic relocation entries are allocated in the same
+// order as if all relocations were scanned serially.
+template <class ELFT, class RelTy>
+static void scanRelocs(InputSectionBase &Sec, ArrayRef<RelTy> Rels,
+                       ArrayRef<ScannedReloc> Scanned) {
+  // handleTlsRelocation may consume more than one relocation.
+  uint32_t SkipUntil = 0;
+
+  for (const ScannedReloc &R : Scanned) {
+    if (R.Index < SkipUntil)
+      continue;
+    if (R.Deferred) {
+      SkipUntil = R.Index + scanReloc<ELFT>(Sec, Rels, R);
       continue;
     }
+    if (ErrorCount)
+      continue;
 
-    // If the relocation points to something in the file, we can process it.
-    bool IsConstant =
-        isStaticLinkTimeConstant<ELFT>(Expr, Type, Body, Sec, Rel.r_offset);
-
-    // The size is not going to change, so we fold it in here.
-    if (Expr == R_SIZE)
-      Addend += Body.getSize<ELFT>();
-
-    // If the output being produced is position independent, the final value
-    // is still not known. In that case we still need some help from the
-    // dynamic linker. We can however do better than just copying the incoming
-    // relocation. We can process some of it and and just ask the dynamic
-    // linker to add the load address.
-    if (!IsConstant)
-      In<ELFT>::RelaDyn->addReloc(
-          {Target->RelativeRel, &Sec, Offset, true, &Body, Addend});
-
-    // If the produced value is a constant, we just remember to write it
-    // when outputting this section. We also have to do it if the format
-    // uses Elf_Rel, since in that case the written value is the addend.
-    if (IsConstant || !RelTy::IsRela)
-      Sec.Relocations.push_back({Expr, Type, Offset, Addend, &Body});
+    if (R.HasGotOffRel)
+      InX::Got->HasGotOffRel = true;
+    if (R.NeedsGot && !R.Body->isInGot())
+      addGotEntry<ELFT>(*R.Body, false);
+    bool Packed = R.NeedsDynRel &&
+                  addRelativeReloc<ELFT>(&Sec, R.Offset, R.Body, R.Addend);
+    if (R.NeedsRel || Packed)
+      Sec.Relocations.push_back({R.Expr, R.Type, R.Offset, R.Addend, R.Body});
   }
 }
 
-template <class ELFT> void elf::scanRelocations(InputSectionBase &S) {
-  if (S.AreRelocsRela)
-    scanRelocs<ELFT>(S, S.relas<ELFT>());
-  else
-    scanRelocs<ELFT>(S, S.rels<ELFT>());
+template <class ELFT>
+void elf::scanRelocations(ArrayRef<InputSectionBase *> Sections) {
+  // Reporting an error needs toString() of input files, which caches its
+  // result, so we call it here before going multi-threaded.
+  for (ObjectFile<ELFT> *F : Symtab<ELFT>::X->getObjectFiles())
+    toString(F);
+
+  // Sections are grouped by file, and each group is processed by a single
+  // thread, because error messages may lazily parse the file's debug info.
+  std::vector<std::vector<size_t>> Groups;
+  DenseMap<InputFile *, size_t> GroupIds;
+  for (size_t I = 0, E = Sections.size(); I != E; ++I) {
+    auto P = GroupIds.insert({Sections[I]->File, Groups.size()});
+    if (P.second)
+      Groups.emplace_back();
+    Groups[P.first->second].push_back(I);
+  }
+
+  std::vector<std::vector<ScannedReloc>> Scanned(Sections.size());
+  parallelForEach(Groups.begin(), Groups.end(),
+                  [&](const std::vector<size_t> &Group) {
+                    for (size_t I : Group) {
+                      InputSectionBase &S = *Sections[I];
+                      if (S.AreRelocsRela)
+                        Scanned[I] = preScanRelocs<ELFT>(S, S.relas<ELFT>());
+                      else
+                        Scanned[I] = preScanRelocs<ELFT>(S, S.rels<ELFT>());
+                    }
+                  });
+
+  for (size_t I = 0, E = Sections.size(); I != E; ++I) {
+    InputSectionBase &S = *Sections[I];
+    if (S.AreRelocsRela)
+      scanRelocs<ELFT>(S, S.relas<ELFT>(), Scanned[I]);
+    else
+      scanRelocs<ELFT>(S, S.rels<ELFT>(), Scanned[I]);
+    std::vector<ScannedReloc>().swap(Scanned[I]);
+  }
 }
 
-// Insert the Thunks for OutputSection OS into their designated place
+// Insert the Thunks created in this pass into their designated place
 // in the Sections vector, and recalculate the InputSection output section
 // offsets.
 // This may invalidate any output section offsets stored outside of InputSection
 void ThunkCreator::mergeThunks() {
   for (auto &KV : ThunkSections) {
     std::vector<InputSection *> *ISR = KV.first;
-    std::vector<ThunkSection *> &Thunks = KV.second;
+
+    // Remove any zero sized precreated ThunkSections so that they don't
+    // add alignment padding to the output.
+    auto I = std::remove_if(KV.second.begin(), KV.second.end(),
+                            [](const std::pair<ThunkSection *, uint32_t> &TS) {
+                              return TS.first->getSize() == 0;
+                            });
+    KV.second.erase(I, KV.second.end());
+
+    std::vector<ThunkSection *> NewThunks;
+    for (const std::pair<ThunkSection *, uint32_t> &TS : KV.second)
+      if (TS.second == Pass)
+        NewThunks.push_back(TS.first);
+    if (NewThunks.empty())
+      continue;
 
     // Order Thunks in ascending OutSecOff
     auto ThunkCmp = [](const ThunkSection *A, const ThunkSection *B) {
       return A->OutSecOff < B->OutSecOff;
     };
-    std::stable_sort(Thunks.begin(), Thunks.end(), ThunkCmp);
+    std::stable_sort(NewThunks.begin(), NewThunks.end(), ThunkCmp);
 
     // Merge sorted vectors of Thunks and InputSections by OutSecOff
     std::vector<InputSection *> Tmp;
-    Tmp.reserve(ISR->size() + Thunks.size());
+    Tmp.reserve(ISR->size() + NewThunks.size());
     auto MergeCmp = [](const InputSection *A, const InputSection *B) {
       // std::merge requires a strict weak ordering.
       if (A->OutSecOff < B->OutSecOff)
@@ -994,27 +1171,71 @@ void ThunkCreator::mergeThunks() {
             return true;
       return false;
     };
-    std::merge(ISR->begin(), ISR->end(), Thunks.begin(), Thunks.end(),
+    std::merge(ISR->begin(), ISR->end(), NewThunks.begin(), NewThunks.end(),
                std::back_inserter(Tmp), MergeCmp);
     *ISR = std::move(Tmp);
   }
 }
 
-ThunkSection *ThunkCreator::getOSThunkSec(OutputSection *OS,
-                                          std::vector<InputSection *> *ISR) {
-  if (CurTS == nullptr) {
-    uint32_t Off = 0;
-    for (auto *IS : OS->Sections) {
-      Off = IS->OutSecOff + IS->getSize();
-      if ((IS->Flags & SHF_EXECINSTR) == 0)
-        break;
-    }
-    CurTS = addThunkSection(OS, ISR, Off);
+// Create one or more ThunkSections per vector of InputSections that can be
+// used to place range extension Thunks. A ThunkSection is placed every
+// Target->ThunkSectionSpacing bytes, at the end of the last InputSection
+// that fits below the limit, and one more at the end of the vector. A
+// vector that is smaller than the spacing gets a single ThunkSection at the
+// end. This keeps the number of ThunkSections low while putting a
+// ThunkSection within range of every caller.
+void ThunkCreator::createInitialThunkSections(
+    ArrayRef<OutputSectionCommand *> OutputSections) {
+  forEachExecInputSectionRange(
+      OutputSections,
+      [&](OutputSection *OS, std::vector<InputSection *> *ISR) {
+        if (ISR->empty())
+          return;
+        uint64_t ISLimit = 0;
+        uint64_t PrevISLimit = ISR->front()->OutSecOff;
+        uint64_t ThunkUpperBound = PrevISLimit + Target->ThunkSectionSpacing;
+
+        for (const InputSection *IS : *ISR) {
+          ISLimit = IS->OutSecOff + IS->getSize();
+          if (ISLimit > ThunkUpperBound) {
+            addThunkSection(OS, ISR, PrevISLimit);
+            ThunkUpperBound = PrevISLimit + Target->ThunkSectionSpacing;
+          }
+          PrevISLimit = ISLimit;
+        }
+        addThunkSection(OS, ISR, ISLimit);
+      });
+}
+
+// Find a ThunkSection in ISR that a branch at Src with relocation Type can
+// reach. If there is none, create one as close to IS as possible.
+ThunkSection *ThunkCreator::getISRThunkSec(OutputSection *OS, InputSection *IS,
+                                           std::vector<InputSection *> *ISR,
+                                           uint32_t Type, uint64_t Src) {
+  for (const std::pair<ThunkSection *, uint32_t> &TP : ThunkSections[ISR]) {
+    ThunkSection *TS = TP.first;
+    uint64_t TSBase = OS->Addr + TS->OutSecOff;
+    uint64_t TSLimit = TSBase + TS->getSize();
+    if (Target->inBranchRange(Type, Src, (Src > TSLimit) ? TSBase : TSLimit))
+      return TS;
+  }
+
+  // No suitable ThunkSection exists. This can happen when there is a branch
+  // with lower range than the ThunkSection spacing or when there are too
+  // many Thunks. Create a new ThunkSection as close to the InputSection as
+  // possible. Error if InputSection is so large we cannot place ThunkSection
+  // anywhere in range.
+  uint64_t ThunkSecOff = IS->OutSecOff;
+  if (!Target->inBranchRange(Type, Src, OS->Addr + ThunkSecOff)) {
+    ThunkSecOff = IS->OutSecOff + IS->getSize();
+    if (!Target->inBranchRange(Type, Src, OS->Addr + ThunkSecOff))
+      fatal(toString(IS) + ": input section too large for range extension "
+            "thunk");
   }
-  return CurTS;
+  return addThunkSection(OS, ISR, ThunkSecOff);
 }
 
-ThunkSection *ThunkCreator::getISThunkSec(InputSection *IS, OutputSection *OS) {
+ThunkSection *ThunkCreator::getISThunkSec(InputSection *IS) {
   ThunkSection *TS = ThunkedSections.lookup(IS);
   if (TS)
     return TS;
@@ -1042,37 +1263,55 @@ ThunkSection *ThunkCreator::addThunkSection(OutputSection *OS,
                                             std::vector<InputSection *> *ISR,
                                             uint64_t Off) {
   auto *TS = make<ThunkSection>(OS, Off);
-  ThunkSections[ISR].push_back(TS);
+  ThunkSections[ISR].push_back(std::make_pair(TS, Pass));
   return TS;
 }
 
+// Return a Thunk for Body that a branch at Src with relocation Type can
+// use. An existing Thunk is reused if it is in range, so callers close to
+// each other share a single Thunk. The second member of the pair is true
+// if the Thunk is new.
+std::pair<Thunk *, bool> ThunkCreator::getThunk(SymbolBody &Body, uint32_t Type,
+                                                uint64_t Src) {
+  std::vector<Thunk *> &ThunkVec = ThunkedSymbols[&Body];
+  for (Thunk *T : ThunkVec)
+    if (T->isCompatibleWith(Type) &&
+        Target->inBranchRange(Type, Src, T->ThunkSym->getVA()))
+      return std::make_pair(T, false);
+
+  Thunk *T = addThunk(Type, Body);
+  ThunkVec.push_back(T);
+  return std::make_pair(T, true);
+}
 
-std::pair<Thunk *, bool> ThunkCreator::getThunk(SymbolBody &Body,
-                                                uint32_t Type) {
-  auto res = ThunkedSymbols.insert({&Body, nullptr});
-  if (res.second)
-    res.first->second = addThunk(Type, Body);
-  return std::make_pair(res.first->second, res.second);
+// If Rel was redirected to a Thunk in a previous pass, return true if the
+// Thunk is still in range. Otherwise, point Rel back to the Thunk's
+// destination so that it can be given another Thunk.
+bool ThunkCreator::normalizeExistingThunk(Relocation &Rel, uint64_t Src) {
+  Thunk *T = Thunks.lookup(Rel.Sym);
+  if (!T)
+    return false;
+  if (Target->inBranchRange(Rel.Type, Src, Rel.Sym->getVA()))
+    return true;
+  Rel.Sym = &T->Destination;
+  if (Rel.Sym->isInPlt())
+    Rel.Expr = toPlt(Rel.Expr);
+  return false;
 }
 
-// Call Fn on every executable InputSection accessed via the linker script
-// InputSectionDescription::Sections.
-void ThunkCreator::forEachExecInputSection(
+// Call Fn on every vector of executable InputSections accessed via the
+// linker script InputSectionDescription::Sections.
+void ThunkCreator::forEachExecInputSectionRange(
     ArrayRef<OutputSectionCommand *> OutputSections,
-    std::function<void(OutputSection *, std::vector<InputSection *> *,
-                       InputSection *)>
-        Fn) {
+    std::function<void(OutputSection *, std::vector<InputSection *> *)> Fn) {
   for (OutputSectionCommand *Cmd : OutputSections) {
     OutputSection *OS = Cmd->Sec;
     if (!(OS->Flags & SHF_ALLOC) || !(OS->Flags & SHF_EXECINSTR))
       continue;
     if (OutputSectionCommand *C = Script->getCmd(OS))
       for (BaseCommand *BC : C->Commands)
-        if (auto *ISD = dyn_cast<InputSectionDescription>(BC)) {
-          CurTS = nullptr;
-          for (InputSection* IS : ISD->Sections)
-            Fn(OS, &ISD->Sections, IS);
-        }
+        if (auto *ISD = dyn_cast<InputSectionDescription>(BC))
+          Fn(OS, &ISD->Sections);
   }
 }
 
@@ -1084,12 +1323,21 @@ void ThunkCreator::forEachExecInputSection(
 // finalized. If any Thunks are added to an OutputSection the output section
 // offsets of the InputSections will change.
 //
-// FIXME: All Thunks are assumed to be in range of the relocation. Range
-// extension Thunks are not yet supported.
+// Addresses must have been assigned before each call. Adding Thunks moves
+// the InputSections that follow them, which may put a branch that was in
+// range out of range, so the caller must reassign addresses and call
+// createThunks again until it returns false.
 bool ThunkCreator::createThunks(
     ArrayRef<OutputSectionCommand *> OutputSections) {
-  if (Pass > 0)
-    ThunkSections.clear();
+  if (Pass == 0 && Target->ThunkSectionSpacing)
+    createInitialThunkSections(OutputSections);
+
+  // With Thunks much smaller than the branch range we expect to converge
+  // in a few passes; if we get to 10 something has gone wrong. Passes
+  // that add no Thunks don't count because the caller may call us again
+  // only because another section, such as .relr.dyn, has grown.
+  if (NumChangedPasses == 10)
+    fatal("thunk creation not converged");
 
   // Create all the Thunks and insert them into synthetic ThunkSections. The
   // ThunkSections are later inserted back into the OutputSection.
@@ -1097,39 +1345,55 @@ bool ThunkCreator::createThunks(
   // We separate the creation of ThunkSections from the insertion of the
   // ThunkSections back into the OutputSection as ThunkSections are not always
   // inserted into the same OutputSection as the caller.
-  forEachExecInputSection(
-      OutputSections, [&](OutputSection *OS,  std::vector<InputSection*> *ISR,
-                          InputSection *IS) {
-        for (Relocation &Rel : IS->Relocations) {
-          SymbolBody &Body = *Rel.Sym;
-          if (Thunks.find(&Body) != Thunks.end() ||
-              !Target->needsThunk(Rel.Expr, Rel.Type, IS->File, Body))
-            continue;
-          Thunk *T;
-          bool IsNew;
-          std::tie(T, IsNew) = getThunk(Body, Rel.Type);
-          if (IsNew) {
-            // Find or create a ThunkSection for the new Thunk
-            ThunkSection *TS;
-            if (auto *TIS = T->getTargetInputSection())
-              TS = getISThunkSec(TIS, OS);
-            else
-              TS = getOSThunkSec(OS, ISR);
-            TS->addThunk(T);
-            Thunks[T->ThunkSym] = T;
+  bool AddressesChanged = false;
+  forEachExecInputSectionRange(
+      OutputSections,
+      [&](OutputSection *OS, std::vector<InputSection *> *ISR) {
+        for (InputSection *IS : *ISR)
+          for (Relocation &Rel : IS->Relocations) {
+            uint64_t Src = OS->Addr + IS->getOffset(Rel.Offset);
+
+            // If we are a relocation to an existing Thunk, check if it is
+            // still in range. If not then Rel will be altered to point to its
+            // original target so another Thunk can be generated.
+            if (Pass > 0 && normalizeExistingThunk(Rel, Src))
+              continue;
+
+            SymbolBody &Body = *Rel.Sym;
+            if (!Target->needsThunk(Rel.Expr, Rel.Type, IS->File, Src, Body))
+              continue;
+            Thunk *T;
+            bool IsNew;
+            std::tie(T, IsNew) = getThunk(Body, Rel.Type, Src);
+            if (IsNew) {
+              // Find or create a ThunkSection for the new Thunk
+              ThunkSection *TS;
+              if (auto *TIS = T->getTargetInputSection())
+                TS = getISThunkSec(TIS);
+              else
+                TS = getISRThunkSec(OS, IS, ISR, Rel.Type, Src);
+              TS->addThunk(T);
+              Thunks[T->ThunkSym] = T;
+              AddressesChanged = true;
+            }
+            // Redirect relocation to Thunk, we never go via the PLT to a Thunk
+            Rel.Sym = T->ThunkSym;
+            Rel.Expr = fromPlt(Rel.Expr);
           }
-          // Redirect relocation to Thunk, we never go via the PLT to a Thunk
-          Rel.Sym = T->ThunkSym;
-          Rel.Expr = fromPlt(Rel.Expr);
-        }
       });
   // Merge all created synthetic ThunkSections back into OutputSection
   mergeThunks();
   ++Pass;
-  return !ThunkSections.empty();
+  if (AddressesChanged)
+    ++NumChangedPasses;
+  return AddressesChanged;
 }
 
-template void elf::scanRelocations<ELF32LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF32BE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64BE>(InputSectionBase &);
+template void
+elf::scanRelocations<ELF32LE>(ArrayRef<InputSectionBase *>);
+template void
+elf::scanRelocations<ELF32BE>(ArrayRef<InputSectionBase *>);
+template void
+elf::scanRelocations<ELF64LE>(ArrayRef<InputSectionBase *>);
+template void
+elf::scanRelocations<ELF64BE>(ArrayRef<InputSectionBase *>);
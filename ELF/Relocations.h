@@ -116,7 +116,8 @@ struct Relocation {
   SymbolBody *Sym;
 };
 
-template <class ELFT> void scanRelocations(InputSectionBase &);
+template <class ELFT>
+void scanRelocations(ArrayRef<InputSectionBase *> Sections);
 
 class ThunkSection;
 class Thunk;
@@ -127,25 +128,33 @@ public:
   bool createThunks(ArrayRef<OutputSectionCommand *> OutputSections);
 
   // The number of completed passes of createThunks this permits us
-  // to do one time initialization on Pass 0 and put a limit on the
-  // number of times it can be called to prevent infinite loops.
+  // to do one time initialization on Pass 0.
   uint32_t Pass = 0;
 
+  // The number of passes that added Thunks. It is limited to prevent
+  // infinite loops.
+  uint32_t NumChangedPasses = 0;
+
 private:
   void mergeThunks();
-  ThunkSection *getOSThunkSec(OutputSection *OS,
-                              std::vector<InputSection *> *ISR);
-  ThunkSection *getISThunkSec(InputSection *IS, OutputSection *OS);
-  void forEachExecInputSection(
+  void
+  createInitialThunkSections(ArrayRef<OutputSectionCommand *> OutputSections);
+  ThunkSection *getISRThunkSec(OutputSection *OS, InputSection *IS,
+                               std::vector<InputSection *> *ISR,
+                               uint32_t Type, uint64_t Src);
+  ThunkSection *getISThunkSec(InputSection *IS);
+  void forEachExecInputSectionRange(
       ArrayRef<OutputSectionCommand *> OutputSections,
-      std::function<void(OutputSection *, std::vector<InputSection *> *,
-                         InputSection *)>
-          Fn);
-  std::pair<Thunk *, bool> getThunk(SymbolBody &Body, uint32_t Type);
+      std::function<void(OutputSection *, std::vector<InputSection *> *)> Fn);
+  std::pair<Thunk *, bool> getThunk(SymbolBody &Body, uint32_t Type,
+                                    uint64_t Src);
+  bool normalizeExistingThunk(Relocation &Rel, uint64_t Src);
   ThunkSection *addThunkSection(OutputSection *OS,
                                 std::vector<InputSection *> *, uint64_t Off);
-  // Track Symbols that already have a Thunk
-  llvm::DenseMap<SymbolBody *, Thunk *> ThunkedSymbols;
+
+  // Record all the available Thunks for a Symbol. There can be more than
+  // one if the callers are too far apart to share a Thunk.
+  llvm::DenseMap<SymbolBody *, std::vector<Thunk *>> ThunkedSymbols;
 
   // Find a Thunk from the Thunks symbol definition, we can use this to find
   // the Thunk from a relocation to the Thunks symbol definition.
@@ -154,15 +163,14 @@ private:
   // Track InputSections that have a ThunkSection placed in front
   llvm::DenseMap<InputSection *, ThunkSection *> ThunkedSections;
 
-  // All the ThunkSections that we have created, organised by OutputSection
-  // will contain a mix of ThunkSections that have been created this pass, and
-  // ThunkSections that have been merged into the OutputSection on previous
-  // passes
-  std::map<std::vector<InputSection *> *, std::vector<ThunkSection *>>
+  // All the ThunkSections that we have created, organised by the vector of
+  // InputSections they are placed in. The second member of each pair is
+  // the pass the ThunkSection was created in. ThunkSections from earlier
+  // passes have already been merged into the InputSections and may be
+  // reused for new Thunks.
+  std::map<std::vector<InputSection *> *,
+           std::vector<std::pair<ThunkSection *, uint32_t>>>
       ThunkSections;
-
-  // The ThunkSection for this vector of InputSections
-  ThunkSection *CurTS;
 };
 
 // Return a int64_t to make sure we get the sign extension out of the way as
@@ -16,22 +16,245 @@
 #include "llvm/Demangle/Demangle.h"
 #include <algorithm>
 #include <cstring>
+#include <map>
 
 using namespace llvm;
 using namespace lld;
 using namespace lld::elf;
 
-StringMatcher::StringMatcher(ArrayRef<StringRef> Pat) {
+StringMatcher::StringMatcher(ArrayRef<StringRef> Pat) : Strings(Pat) {
+  std::vector<StringRef> Globs;
   for (StringRef S : Pat) {
-    Expected<GlobPattern> Pat = GlobPattern::create(S);
-    if (!Pat)
-      error(toString(Pat.takeError()));
-    else
-      Patterns.push_back(*Pat);
+    Expected<GlobPattern> Glob = GlobPattern::create(S);
+    if (!Glob) {
+      error(toString(Glob.takeError()));
+      continue;
+    }
+
+    if (!hasWildcard(S)) {
+      Exact.insert(S);
+    } else if (S.endswith("*") && !hasWildcard(S.drop_back())) {
+      Prefixes.insert(S.drop_back());
+    } else if (S.startswith("*") && !hasWildcard(S.drop_front())) {
+      Suffixes.insert(S.drop_front());
+    } else {
+      Patterns.push_back(*Glob);
+      Globs.push_back(S);
+    }
+  }
+
+  for (StringRef S : Prefixes)
+    PrefixLengths.push_back(S.size());
+  for (StringRef S : Suffixes)
+    SuffixLengths.push_back(S.size());
+  for (std::vector<size_t> *V : {&PrefixLengths, &SuffixLengths}) {
+    std::sort(V->begin(), V->end());
+    V->erase(std::unique(V->begin(), V->end()), V->end());
+  }
+
+  if (!Globs.empty())
+    compile(Globs);
+}
+
+// Parses a glob pattern into tokens in the same way as GlobPattern does.
+// Each token is a set of bytes that matches a single byte, or an empty
+// set for "*". S must be a valid glob pattern.
+static std::vector<BitVector> tokenize(StringRef S) {
+  std::vector<BitVector> Ret;
+  while (!S.empty()) {
+    char C = S[0];
+    S = S.substr(1);
+
+    if (C == '*') {
+      Ret.emplace_back();
+      continue;
+    }
+    if (C == '?') {
+      Ret.emplace_back(256, true);
+      continue;
+    }
+
+    if (C == '[') {
+      size_t End = S.find(']');
+      StringRef Chars = S.substr(0, End);
+      S = S.substr(End + 1);
+
+      bool Negate = Chars.startswith("^");
+      if (Negate)
+        Chars = Chars.substr(1);
+
+      BitVector BV(256, false);
+      while (!Chars.empty()) {
+        if (Chars.size() >= 3 && Chars[1] == '-') {
+          for (int I = (uint8_t)Chars[0]; I <= (uint8_t)Chars[2]; ++I)
+            BV[I] = true;
+          Chars = Chars.substr(3);
+        } else {
+          BV[(uint8_t)Chars[0]] = true;
+          Chars = Chars.substr(1);
+        }
+      }
+      if (Negate)
+        BV.flip();
+      Ret.push_back(std::move(BV));
+      continue;
+    }
+
+    if (C == '\\' && !S.empty()) {
+      C = S[0];
+      S = S.substr(1);
+    }
+    BitVector BV(256, false);
+    BV[(uint8_t)C] = true;
+    Ret.push_back(std::move(BV));
+  }
+
+  // GlobPattern lets a run of two or more trailing stars match only a
+  // non-empty string ("a**" matches "ab" but not "a"). Do the same by
+  // rewriting such a run as "?*".
+  size_t NumStars = 0;
+  while (NumStars < Ret.size() && Ret[Ret.size() - NumStars - 1].empty())
+    ++NumStars;
+  if (NumStars >= 2) {
+    Ret.resize(Ret.size() - NumStars);
+    Ret.emplace_back(256, true);
+    Ret.emplace_back();
+  }
+  return Ret;
+}
+
+// Compiles glob patterns into a DFA using the subset construction. The
+// DFA may grow exponentially for patterns such as "*a*b*c*d*", so if it
+// has too many states, we give up and try patterns one by one instead.
+void StringMatcher::compile(ArrayRef<StringRef> Pat) {
+  const size_t MaxStates = 4096;
+
+  // Build an NFA first. A pattern with N tokens has N + 1 states, and
+  // state I means that the first I tokens have been matched.
+  struct NFAState {
+    BitVector Chars;
+    bool Star = false;
+    bool Final = false;
+  };
+  std::vector<NFAState> NFA;
+  std::vector<uint32_t> Init;
+
+  for (StringRef S : Pat) {
+    Init.push_back(NFA.size());
+    for (BitVector &BV : tokenize(S)) {
+      NFA.emplace_back();
+      NFA.back().Star = BV.empty();
+      NFA.back().Chars = std::move(BV);
+    }
+    NFA.emplace_back();
+    NFA.back().Final = true;
+  }
+
+  // "*" may match the empty string, so a state for "*" implies the
+  // next state.
+  auto Close = [&](std::vector<uint32_t> &V) {
+    for (size_t I = 0; I < V.size(); ++I)
+      if (NFA[V[I]].Star)
+        V.push_back(V[I] + 1);
+    std::sort(V.begin(), V.end());
+    V.erase(std::unique(V.begin(), V.end()), V.end());
+  };
+
+  // Bytes that no token distinguishes from each other can share
+  // DFA transitions. Partition bytes into such classes.
+  NumClasses = 1;
+  for (NFAState &St : NFA) {
+    if (St.Star || St.Final)
+      continue;
+    std::vector<int> Map(NumClasses * 2, -1);
+    unsigned N = 0;
+    for (int C = 0; C < 256; ++C) {
+      int &Id = Map[ByteClass[C] * 2 + St.Chars[C]];
+      if (Id == -1)
+        Id = N++;
+      ByteClass[C] = Id;
+    }
+    NumClasses = N;
+  }
+
+  uint8_t Rep[256];
+  for (int C = 0; C < 256; ++C)
+    Rep[ByteClass[C]] = C;
+
+  // Now run the subset construction. State 0 is the initial state.
+  std::map<std::vector<uint32_t>, uint32_t> Ids;
+  std::vector<std::vector<uint32_t>> States;
+
+  auto GetId = [&](std::vector<uint32_t> V) {
+    auto P = Ids.insert({V, States.size()});
+    if (P.second)
+      States.push_back(std::move(V));
+    return P.first->second;
+  };
+
+  Close(Init);
+  GetId(Init);
+
+  for (size_t I = 0; I < States.size(); ++I) {
+    if (States.size() > MaxStates) {
+      Transitions.clear();
+      Accepting.clear();
+      return;
+    }
+
+    for (unsigned K = 0; K < NumClasses; ++K) {
+      std::vector<uint32_t> Next;
+      for (uint32_t S : States[I]) {
+        if (NFA[S].Star)
+          Next.push_back(S);
+        else if (!NFA[S].Final && NFA[S].Chars[Rep[K]])
+          Next.push_back(S + 1);
+      }
+      Close(Next);
+      Transitions.push_back(GetId(std::move(Next)));
+    }
   }
+
+  for (std::vector<uint32_t> &V : States)
+    Accepting.push_back(std::any_of(V.begin(), V.end(),
+                                    [&](uint32_t S) { return NFA[S].Final; }));
+
+  auto It = Ids.find(std::vector<uint32_t>());
+  DeadState = (It == Ids.end()) ? States.size() : It->second;
+  Patterns.clear();
+}
+
+bool StringMatcher::matchDFA(StringRef S) const {
+  uint32_t State = 0;
+  for (char C : S) {
+    State = Transitions[State * NumClasses + ByteClass[(uint8_t)C]];
+    if (State == DeadState)
+      return false;
+  }
+  return Accepting[State];
 }
 
 bool StringMatcher::match(StringRef S) const {
+  if (Exact.count(S))
+    return true;
+
+  for (size_t Len : PrefixLengths) {
+    if (Len > S.size())
+      break;
+    if (Prefixes.count(S.take_front(Len)))
+      return true;
+  }
+
+  for (size_t Len : SuffixLengths) {
+    if (Len > S.size())
+      break;
+    if (Suffixes.count(S.take_back(Len)))
+      return true;
+  }
+
+  if (!Transitions.empty())
+    return matchDFA(S);
+
   for (const GlobPattern &Pat : Patterns)
     if (Pat.match(S))
       return true;
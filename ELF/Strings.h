@@ -13,6 +13,7 @@
 #include "lld/Core/LLVM.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/GlobPattern.h"
@@ -58,6 +59,13 @@ private:
 };
 
 // This class represents multiple glob patterns.
+//
+// Patterns are compiled so that match() doesn't have to try each pattern
+// in turn. Patterns without metacharacters and patterns in the form of
+// "foo*" or "*foo" are looked up in hash tables, and all the other
+// patterns are compiled into a single DFA, so that one pass over a given
+// string decides whether it matches any of them. This matters when a
+// version script has thousands of patterns.
 class StringMatcher {
 public:
   StringMatcher() = default;
@@ -65,7 +73,34 @@ public:
 
   bool match(StringRef S) const;
 
+  // Returns the glob patterns given to the constructor.
+  ArrayRef<StringRef> getPatterns() const { return Strings; }
+
 private:
+  void compile(ArrayRef<StringRef> Pat);
+  bool matchDFA(StringRef S) const;
+
+  std::vector<StringRef> Strings;
+
+  // Patterns without metacharacters.
+  llvm::DenseSet<StringRef> Exact;
+
+  // Literal parts of "foo*" and "*foo" patterns and their distinct
+  // lengths in ascending order.
+  llvm::DenseSet<StringRef> Prefixes;
+  llvm::DenseSet<StringRef> Suffixes;
+  std::vector<size_t> PrefixLengths;
+  std::vector<size_t> SuffixLengths;
+
+  // A DFA for the other patterns. Bytes are mapped to equivalence
+  // classes first so that the transition table is small.
+  uint8_t ByteClass[256] = {};
+  unsigned NumClasses = 0;
+  std::vector<uint32_t> Transitions;
+  std::vector<bool> Accepting;
+  uint32_t DeadState = 0;
+
+  // Used instead of the DFA if it would be too large.
   std::vector<llvm::GlobPattern> Patterns;
 };
 
@@ -20,7 +20,9 @@
 #include "LinkerScript.h"
 #include "Memory.h"
 #include "Symbols.h"
+#include "Threads.h"
 #include "llvm/ADT/STLExtras.h"
+#include <array>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -104,6 +106,88 @@ template <class ELFT> void SymbolTable<ELFT>::addFile(InputFile *File) {
   F->parse(ComdatGroups);
 }
 
+template <class ELFT> constexpr size_t SymbolTable<ELFT>::NumShards;
+
+// Symbol resolution is a sequential process because its result depends
+// on the order of input files. For example, the first strong definition
+// wins, and archive members are fetched in the middle of the process.
+// However, a good part of the cost of adding files is parsing object
+// files and inserting symbol names to the hash table, which doesn't
+// depend on the order.
+//
+// This function does that part for the given files in parallel, so that
+// addFile() later only has to do the order-dependent part. Hash table
+// entries created here have index -1, meaning that no symbol has been
+// created for them yet, so the resulting order of SymVector is not
+// affected.
+template <class ELFT>
+void SymbolTable<ELFT>::preParse(ArrayRef<InputFile *> Files) {
+  std::vector<ObjectFile<ELFT> *> Objs;
+  for (InputFile *F : Files)
+    if (isa<ObjectFile<ELFT>>(F) && F->EKind == Config->EKind &&
+        F->EMachine == Config->EMachine)
+      Objs.push_back(cast<ObjectFile<ELFT>>(F));
+
+  auto ByShard = [](const std::pair<CachedHashStringRef, uint32_t> &A,
+                    const std::pair<CachedHashStringRef, uint32_t> &B) {
+    return getShardId(A.first) < getShardId(B.first);
+  };
+
+  // Find the first file that defines each comdat group. Groups in other
+  // files are discarded by resolveSections() anyway because files are
+  // added in this order, so we don't need to create their members.
+  // Groups that lose to archive members fetched in the middle are still
+  // discarded by resolveSections().
+  std::vector<std::vector<std::pair<CachedHashStringRef, uint32_t>>> Groups(
+      Objs.size());
+  parallelForEachN(0, Objs.size(), [&](size_t I) {
+    Groups[I] = Objs[I]->getComdatGroups();
+    std::stable_sort(Groups[I].begin(), Groups[I].end(), ByShard);
+  });
+
+  std::vector<DenseMap<CachedHashStringRef, uint32_t>> Owners(NumShards);
+  parallelForEachN(0, NumShards, [&](size_t ShardId) {
+    for (size_t I = 0, E = Groups.size(); I < E; ++I) {
+      auto It = std::partition_point(
+          Groups[I].begin(), Groups[I].end(),
+          [&](const std::pair<CachedHashStringRef, uint32_t> &P) {
+            return getShardId(P.first) < ShardId;
+          });
+      for (; It != Groups[I].end() && getShardId(It->first) == ShardId; ++It)
+        Owners[ShardId].insert({It->first, I});
+    }
+  });
+
+  // Parse files and hash symbol names. Names are grouped by shard.
+  std::vector<std::vector<CachedHashStringRef>> Names(Objs.size());
+  parallelForEachN(0, Objs.size(), [&](size_t I) {
+    std::vector<uint32_t> Duplicates;
+    for (std::pair<CachedHashStringRef, uint32_t> &P : Groups[I])
+      if (Owners[getShardId(P.first)].lookup(P.first) != I)
+        Duplicates.push_back(P.second);
+    std::sort(Duplicates.begin(), Duplicates.end());
+
+    Objs[I]->preParse(Duplicates);
+    Names[I] = Objs[I]->getGlobalSymbolNames();
+    std::stable_sort(Names[I].begin(), Names[I].end(),
+                     [](CachedHashStringRef A, CachedHashStringRef B) {
+                       return getShardId(A) < getShardId(B);
+                     });
+  });
+
+  // Add them to the hash tables. Each shard is owned by one task.
+  parallelForEachN(0, NumShards, [&](size_t ShardId) {
+    MapTy &Map = Symtab[ShardId];
+    for (std::vector<CachedHashStringRef> &V : Names) {
+      auto I = std::partition_point(
+          V.begin(), V.end(),
+          [&](CachedHashStringRef S) { return getShardId(S) < ShardId; });
+      for (; I != V.end() && getShardId(*I) == ShardId; ++I)
+        Map.insert({*I, SymIndex(-1, false)});
+    }
+  });
+}
+
 // This function is where all the optimizations of link-time
 // optimization happens. When LTO is in use, some input files are
 // not in native object file format but in the LLVM bitcode format.
@@ -151,7 +235,8 @@ DefinedRegular *SymbolTable<ELFT>::addIgnored(StringRef Name,
 // Set a flag for --trace-symbol so that we can print out a log message
 // if a new symbol with the same name is inserted into the symbol table.
 template <class ELFT> void SymbolTable<ELFT>::trace(StringRef Name) {
-  Symtab.insert({CachedHashStringRef(Name), {-1, true}});
+  CachedHashStringRef S(Name);
+  getShard(S).insert({S, {-1, true}});
 }
 
 // Rename SYM as __wrap_SYM. The original symbol is preserved as __real_SYM.
@@ -215,14 +300,16 @@ static uint8_t getMinVisibility(uint8_t VA, uint8_t VB) {
 // Find an existing symbol or create and insert a new one.
 template <class ELFT>
 std::pair<Symbol *, bool> SymbolTable<ELFT>::insert(StringRef Name) {
-  auto P = Symtab.insert(
-      {CachedHashStringRef(Name), SymIndex((int)SymVector.size(), false)});
+  CachedHashStringRef S(Name);
+  auto P = getShard(S).insert({S, SymIndex((int)SymVector.size(), false)});
   SymIndex &V = P.first->second;
   bool IsNew = P.second;
 
+  // Index -1 means that the name was added by trace() or preParse(),
+  // but no symbol has been created for it yet.
   if (V.Idx == -1) {
     IsNew = true;
-    V = SymIndex((int)SymVector.size(), true);
+    V = SymIndex((int)SymVector.size(), V.Traced);
   }
 
   Symbol *Sym;
@@ -500,8 +587,10 @@ Symbol *SymbolTable<ELFT>::addBitcode(StringRef Name, uint8_t Binding,
 }
 
 template <class ELFT> SymbolBody *SymbolTable<ELFT>::find(StringRef Name) {
-  auto It = Symtab.find(CachedHashStringRef(Name));
-  if (It == Symtab.end())
+  CachedHashStringRef S(Name);
+  MapTy &Map = getShard(S);
+  auto It = Map.find(S);
+  if (It == Map.end())
     return nullptr;
   SymIndex V = It->second;
   if (V.Idx == -1)
@@ -614,13 +703,21 @@ template <class ELFT> void SymbolTable<ELFT>::scanShlibUndefined() {
 template <class ELFT>
 StringMap<std::vector<SymbolBody *>> &SymbolTable<ELFT>::getDemangledSyms() {
   if (!DemangledSyms) {
+    // Demangling is slow, so do it in parallel.
+    std::vector<Optional<std::string>> Names(SymVector.size());
+    parallelForEachN(0, SymVector.size(), [&](size_t I) {
+      SymbolBody *B = SymVector[I]->body();
+      if (!B->isUndefined())
+        Names[I] = demangle(B->getName());
+    });
+
     DemangledSyms.emplace();
-    for (Symbol *Sym : SymVector) {
-      SymbolBody *B = Sym->body();
+    for (size_t I = 0, E = SymVector.size(); I != E; ++I) {
+      SymbolBody *B = SymVector[I]->body();
       if (B->isUndefined())
         continue;
-      if (Optional<std::string> S = demangle(B->getName()))
-        (*DemangledSyms)[*S].push_back(B);
+      if (Names[I])
+        (*DemangledSyms)[*Names[I]].push_back(B);
       else
         (*DemangledSyms)[B->getName()].push_back(B);
     }
@@ -638,85 +735,74 @@ std::vector<SymbolBody *> SymbolTable<ELFT>::findByVersion(SymbolVersion Ver) {
   return {};
 }
 
+// Returns symbols that a version script pattern containing no wildcard
+// characters applies to, and marks them as being in the version script.
 template <class ELFT>
-std::vector<SymbolBody *>
-SymbolTable<ELFT>::findAllByVersion(SymbolVersion Ver) {
-  std::vector<SymbolBody *> Res;
-  StringMatcher M(Ver.Name);
-
-  if (Ver.IsExternCpp) {
-    for (auto &P : getDemangledSyms())
-      if (M.match(P.first()))
-        Res.insert(Res.end(), P.second.begin(), P.second.end());
-    return Res;
-  }
-
-  for (Symbol *Sym : SymVector) {
-    SymbolBody *B = Sym->body();
-    if (!B->isUndefined() && M.match(B->getName()))
-      Res.push_back(B);
-  }
-  return Res;
-}
-
-// If there's only one anonymous version definition in a version
-// script file, the script does not actually define any symbol version,
-// but just specifies symbols visibilities.
-template <class ELFT> void SymbolTable<ELFT>::handleAnonymousVersion() {
-  for (SymbolVersion &Ver : Config->VersionScriptGlobals)
-    assignExactVersion(Ver, VER_NDX_GLOBAL, "global");
-  for (SymbolVersion &Ver : Config->VersionScriptGlobals)
-    assignWildcardVersion(Ver, VER_NDX_GLOBAL);
-  for (SymbolVersion &Ver : Config->VersionScriptLocals)
-    assignExactVersion(Ver, VER_NDX_LOCAL, "local");
-  for (SymbolVersion &Ver : Config->VersionScriptLocals)
-    assignWildcardVersion(Ver, VER_NDX_LOCAL);
-}
-
-// Set symbol versions to symbols. This function handles patterns
-// containing no wildcard characters.
-template <class ELFT>
-void SymbolTable<ELFT>::assignExactVersion(SymbolVersion Ver, uint16_t VersionId,
-                                           StringRef VersionName) {
-  if (Ver.HasWildcard)
-    return;
-
+std::vector<Symbol *>
+SymbolTable<ELFT>::assignExactVersion(SymbolVersion Ver,
+                                      StringRef VersionName) {
   // Get a list of symbols which we need to assign the version to.
   std::vector<SymbolBody *> Syms = findByVersion(Ver);
   if (Syms.empty()) {
     if (Config->NoUndefinedVersion)
       error("version script assignment of '" + VersionName + "' to symbol '" +
             Ver.Name + "' failed: symbol not defined");
-    return;
+    return {};
   }
 
-  // Assign the version.
+  std::vector<Symbol *> Ret;
   for (SymbolBody *B : Syms) {
     Symbol *Sym = B->symbol();
     if (Sym->InVersionScript)
       warn("duplicate symbol '" + Ver.Name + "' in version script");
-    Sym->VersionId = VersionId;
     Sym->InVersionScript = true;
+    Ret.push_back(Sym);
   }
+  return Ret;
 }
 
-template <class ELFT>
-void SymbolTable<ELFT>::assignWildcardVersion(SymbolVersion Ver,
-                                              uint16_t VersionId) {
-  if (!Ver.HasWildcard)
-    return;
-  std::vector<SymbolBody *> Syms = findAllByVersion(Ver);
+namespace {
+// Wildcard patterns that assign the same version. Patterns in
+// "extern C++" blocks match demangled names.
+struct WildcardVersion {
+  uint16_t Id;
+  StringMatcher Mangled;
+  StringMatcher Demangled;
+};
+} // namespace
 
-  // Exact matching takes precendence over fuzzy matching,
-  // so we set a version to a symbol only if no version has been assigned
-  // to the symbol. This behavior is compatible with GNU.
-  for (SymbolBody *B : Syms)
-    if (B->symbol()->VersionId == Config->DefaultSymbolVersion)
-      B->symbol()->VersionId = VersionId;
+static WildcardVersion getWildcardVersion(ArrayRef<SymbolVersion> Vers,
+                                          uint16_t Id) {
+  std::vector<StringRef> Mangled;
+  std::vector<StringRef> Demangled;
+  for (const SymbolVersion &Ver : Vers)
+    if (Ver.HasWildcard)
+      (Ver.IsExternCpp ? Demangled : Mangled).push_back(Ver.Name);
+  return {Id, StringMatcher(Mangled), StringMatcher(Demangled)};
 }
 
 // This function processes version scripts by updating VersionId
 // member of symbols.
+//
+// Patterns are applied in the following order:
+//
+//  1. exact patterns in the "global:" part of an anonymous version,
+//  2. wildcard patterns in the "global:" part of an anonymous version,
+//  3. exact patterns in "local:" parts,
+//  4. wildcard patterns in "local:" parts,
+//  5. exact patterns of version definitions,
+//  6. wildcard patterns of version definitions in the reverse order.
+//
+// An exact pattern always sets a version to a symbol. A wildcard pattern
+// sets a version only if the symbol still has the default version, so
+// exact matching takes precedence over fuzzy matching, and because we
+// visit version definitions in the reverse order, the last match takes
+// precedence over previous matches. This behavior is compatible with GNU.
+//
+// Exact patterns are handled by hash table lookups, but wildcard patterns
+// need to be matched against all symbols. So we first look up exact
+// patterns and remember the results for each step, and then visit each
+// symbol once in parallel to run the above steps for it.
 template <class ELFT> void SymbolTable<ELFT>::scanVersionScript() {
   // Symbol themselves might know their versions because symbols
   // can contain versions in the form of <name>@<version>.
@@ -725,29 +811,64 @@ template <class ELFT> void SymbolTable<ELFT>::scanVersionScript() {
     for (Symbol *Sym : SymVector)
       Sym->body()->parseSymbolVersion();
 
-  // Handle edge cases first.
-  handleAnonymousVersion();
+  // Versions assigned by exact patterns in steps 1, 3 and 5, or -1.
+  DenseMap<Symbol *, std::array<int, 3>> ExactIds;
+  auto AssignExact = [&](ArrayRef<SymbolVersion> Vers, uint16_t Id,
+                         StringRef VersionName, int Step) {
+    for (const SymbolVersion &Ver : Vers) {
+      if (Ver.HasWildcard)
+        continue;
+      for (Symbol *Sym : assignExactVersion(Ver, VersionName)) {
+        auto P = ExactIds.insert({Sym, {{-1, -1, -1}}});
+        P.first->second[Step] = Id;
+      }
+    }
+  };
 
-  if (Config->VersionDefinitions.empty())
-    return;
+  AssignExact(Config->VersionScriptGlobals, VER_NDX_GLOBAL, "global", 0);
+  AssignExact(Config->VersionScriptLocals, VER_NDX_LOCAL, "local", 1);
+  for (VersionDefinition &V : Config->VersionDefinitions)
+    AssignExact(V.Globals, V.Id, V.Name, 2);
+
+  // Wildcard patterns in steps 2, 4 and 6.
+  std::vector<WildcardVersion> Wildcards[3];
+  Wildcards[0].push_back(
+      getWildcardVersion(Config->VersionScriptGlobals, VER_NDX_GLOBAL));
+  Wildcards[1].push_back(
+      getWildcardVersion(Config->VersionScriptLocals, VER_NDX_LOCAL));
+  for (VersionDefinition &V : llvm::reverse(Config->VersionDefinitions))
+    Wildcards[2].push_back(getWildcardVersion(V.Globals, V.Id));
 
-  // Now we have version definitions, so we need to set version ids to symbols.
-  // Each version definition has a glob pattern, and all symbols that match
-  // with the pattern get that version.
+  bool NeedsDemangle = false;
+  for (std::vector<WildcardVersion> &V : Wildcards)
+    for (WildcardVersion &W : V)
+      if (!W.Demangled.getPatterns().empty())
+        NeedsDemangle = true;
 
-  // First, we assign versions to exact matching symbols,
-  // i.e. version definitions not containing any glob meta-characters.
-  for (VersionDefinition &V : Config->VersionDefinitions)
-    for (SymbolVersion &Ver : V.Globals)
-      assignExactVersion(Ver, V.Id, V.Name);
+  parallelForEachN(0, SymVector.size(), [&](size_t I) {
+    Symbol *Sym = SymVector[I];
+    SymbolBody *B = Sym->body();
+    if (B->isUndefined())
+      return;
 
-  // Next, we assign versions to fuzzy matching symbols,
-  // i.e. version definitions containing glob meta-characters.
-  // Note that because the last match takes precedence over previous matches,
-  // we iterate over the definitions in the reverse order.
-  for (VersionDefinition &V : llvm::reverse(Config->VersionDefinitions))
-    for (SymbolVersion &Ver : V.Globals)
-      assignWildcardVersion(Ver, V.Id);
+    StringRef Name = B->getName();
+    Optional<std::string> Demangled;
+    if (NeedsDemangle)
+      Demangled = demangle(Name);
+    StringRef DemangledName = Demangled ? StringRef(*Demangled) : Name;
+
+    auto It = ExactIds.find(Sym);
+    uint16_t VersionId = Sym->VersionId;
+    for (int Step = 0; Step < 3; ++Step) {
+      if (It != ExactIds.end() && It->second[Step] != -1)
+        VersionId = It->second[Step];
+      for (const WildcardVersion &W : Wildcards[Step])
+        if (VersionId == Config->DefaultSymbolVersion &&
+            (W.Mangled.match(Name) || W.Demangled.match(DemangledName)))
+          VersionId = W.Id;
+    }
+    Sym->VersionId = VersionId;
+  });
 }
 
 template class elf::SymbolTable<ELF32LE>;
@@ -15,6 +15,7 @@
 #include "Strings.h"
 #include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/MathExtras.h"
 
 namespace lld {
 namespace elf {
@@ -38,6 +39,7 @@ template <class ELFT> class SymbolTable {
 
 public:
   void addFile(InputFile *File);
+  void preParse(ArrayRef<InputFile *> Files);
   void addCombinedLTOObject();
   void addSymbolAlias(StringRef Alias, StringRef Name);
   void addSymbolWrap(StringRef Name);
@@ -91,13 +93,10 @@ public:
 
 private:
   std::vector<SymbolBody *> findByVersion(SymbolVersion Ver);
-  std::vector<SymbolBody *> findAllByVersion(SymbolVersion Ver);
 
   llvm::StringMap<std::vector<SymbolBody *>> &getDemangledSyms();
-  void handleAnonymousVersion();
-  void assignExactVersion(SymbolVersion Ver, uint16_t VersionId,
-                          StringRef VersionName);
-  void assignWildcardVersion(SymbolVersion Ver, uint16_t VersionId);
+  std::vector<Symbol *> assignExactVersion(SymbolVersion Ver,
+                                           StringRef VersionName);
 
   struct SymIndex {
     SymIndex(int Idx, bool Traced) : Idx(Idx), Traced(Traced) {}
@@ -105,6 +104,17 @@ private:
     unsigned Traced : 1;
   };
 
+  typedef llvm::DenseMap<llvm::CachedHashStringRef, SymIndex> MapTy;
+
+  // The symbol table is split into shards by hash value so that
+  // preParse() can populate them in parallel.
+  static size_t getShardId(llvm::CachedHashStringRef Name) {
+    return Name.hash() >> (32 - llvm::countTrailingZeros(NumShards));
+  }
+  MapTy &getShard(llvm::CachedHashStringRef Name) {
+    return Symtab[getShardId(Name)];
+  }
+
   // The order the global symbols are in is not defined. We can use an arbitrary
   // order, but it has to be reproducible. That is true even when cross linking.
   // The default hashing of StringRef produces different results on 32 and 64
@@ -112,7 +122,8 @@ private:
   // but a bit inefficient.
   // FIXME: Experiment with passing in a custom hashing or sorting the symbols
   // once symbol resolution is finished.
-  llvm::DenseMap<llvm::CachedHashStringRef, SymIndex> Symtab;
+  constexpr static size_t NumShards = 16;
+  MapTy Symtab[NumShards];
   std::vector<Symbol *> SymVector;
 
   // Comdat groups define "link once" sections. If two comdat groups have the
@@ -25,6 +25,7 @@
 #include "SymbolTable.h"
 #include "Target.h"
 #include "Threads.h"
+#include "Timer.h"
 #include "Writer.h"
 #include "lld/Config/Version.h"
 #include "llvm/BinaryFormat/Dwarf.h"
@@ -32,9 +33,11 @@
 #include "llvm/Object/Decompressor.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/RandomNumberGenerator.h"
 #include "llvm/Support/SHA1.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/xxhash.h"
 #include <cstdlib>
 
@@ -48,6 +51,13 @@ using namespace llvm::support::endian;
 using namespace lld;
 using namespace lld::elf;
 
+// The section type and dynamic tags of packed relative relocations, which
+// are not defined by llvm/BinaryFormat/ELF.h yet.
+static const uint32_t SHT_RELR = 19;
+static const int32_t DT_RELRSZ = 35;
+static const int32_t DT_RELR = 36;
+static const int32_t DT_RELRENT = 37;
+
 uint64_t SyntheticSection::getVA() const {
   if (OutputSection *Sec = getParent())
     return Sec->Addr + OutSecOff;
@@ -816,7 +826,8 @@ void MipsGotSection::finalizeContents() {
   updateAllocSize();
 }
 
-void MipsGotSection::updateAllocSize() {
+bool MipsGotSection::updateAllocSize() {
+  size_t OldSize = Size;
   PageEntriesNum = 0;
   for (std::pair<const OutputSection *, size_t> &P : PageIndexMap) {
     // For each output section referenced by GOT page relocations calculate
@@ -830,6 +841,7 @@ void MipsGotSection::updateAllocSize() {
   }
   Size = (getLocalEntriesNum() + GlobalEntries.size() + TlsEntries.size()) *
          Config->Wordsize;
+  return Size != OldSize;
 }
 
 bool MipsGotSection::empty() const {
@@ -1087,6 +1099,13 @@ template <class ELFT> void DynamicSection<ELFT>::finalizeContents() {
         add({IsRela ? DT_RELACOUNT : DT_RELCOUNT, NumRelativeRels});
     }
   }
+  // .relr.dyn may grow after this function is called, so DT_RELRSZ is
+  // the size of the output section at the time of writing.
+  if (In<ELFT>::RelrDyn && !In<ELFT>::RelrDyn->empty()) {
+    add({DT_RELR, In<ELFT>::RelrDyn});
+    add({DT_RELRSZ, In<ELFT>::RelrDyn->getParent(), Entry::SecSize});
+    add({DT_RELRENT, uint64_t(Config->Wordsize)});
+  }
   if (In<ELFT>::RelaPlt->getParent()->Size > 0) {
     add({DT_JMPREL, In<ELFT>::RelaPlt});
     add({DT_PLTRELSZ, In<ELFT>::RelaPlt->getParent()->Size});
@@ -1214,22 +1233,63 @@ void RelocationSection<ELFT>::addReloc(const DynamicReloc &Reloc) {
   Relocs.push_back(Reloc);
 }
 
-template <class ELFT, class RelTy>
-static bool compRelocations(const RelTy &A, const RelTy &B) {
-  bool AIsRel = A.getType(Config->IsMips64EL) == Target->RelativeRel;
-  bool BIsRel = B.getType(Config->IsMips64EL) == Target->RelativeRel;
-  if (AIsRel != BIsRel)
-    return AIsRel;
+// Sorts V by the first members of its elements. This is a parallel LSD
+// radix sort: in each pass, we split V into chunks, count digits in each
+// chunk concurrently, and then let each chunk scatter its elements to
+// the positions reserved for it. The sort is stable.
+static void radixSort(std::vector<std::pair<uint64_t, uint32_t>> &V,
+                      uint64_t MaxKey) {
+  const size_t Bits = 11;
+  const size_t NumBuckets = 1 << Bits;
+  const size_t ChunkSize = 1 << 16;
+  size_t NumChunks = (V.size() + ChunkSize - 1) / ChunkSize;
+
+  std::vector<std::pair<uint64_t, uint32_t>> Tmp(V.size());
+  std::vector<size_t> Pos(NumChunks * NumBuckets);
+
+  for (size_t Shift = 0; Shift < 64 && (MaxKey >> Shift); Shift += Bits) {
+    std::fill(Pos.begin(), Pos.end(), 0);
+    parallelForEachN(0, NumChunks, [&](size_t C) {
+      size_t *Cnt = &Pos[C * NumBuckets];
+      size_t End = std::min(V.size(), (C + 1) * ChunkSize);
+      for (size_t I = C * ChunkSize; I < End; ++I)
+        ++Cnt[(V[I].first >> Shift) & (NumBuckets - 1)];
+    });
+
+    // Elements in a lower bucket come first, and within a bucket,
+    // elements in an earlier chunk come first.
+    size_t Off = 0;
+    for (size_t B = 0; B < NumBuckets; ++B) {
+      for (size_t C = 0; C < NumChunks; ++C) {
+        size_t N = Pos[C * NumBuckets + B];
+        Pos[C * NumBuckets + B] = Off;
+        Off += N;
+      }
+    }
 
-  return A.getSymbol(Config->IsMips64EL) < B.getSymbol(Config->IsMips64EL);
+    parallelForEachN(0, NumChunks, [&](size_t C) {
+      size_t *Cur = &Pos[C * NumBuckets];
+      size_t End = std::min(V.size(), (C + 1) * ChunkSize);
+      for (size_t I = C * ChunkSize; I < End; ++I)
+        Tmp[Cur[(V[I].first >> Shift) & (NumBuckets - 1)]++] = V[I];
+    });
+    V.swap(Tmp);
+  }
 }
 
+// Dynamic relocation sections can have millions of entries, so we write
+// them in parallel. If Sort is true (-z combreloc), relative relocations
+// come first and the others are grouped by symbol, so that the dynamic
+// linker can process them quickly. We compute that order with a stable
+// radix sort over (relative-first, symbol index) keys and then write each
+// entry directly to its final position.
 template <class ELFT> void RelocationSection<ELFT>::writeTo(uint8_t *Buf) {
-  uint8_t *BufBegin = Buf;
-  for (const DynamicReloc &Rel : Relocs) {
-    auto *P = reinterpret_cast<Elf_Rela *>(Buf);
-    Buf += Config->IsRela ? sizeof(Elf_Rela) : sizeof(Elf_Rel);
+  const size_t ChunkSize = 1 << 14;
+  size_t NumChunks = (Relocs.size() + ChunkSize - 1) / ChunkSize;
+  size_t EntSize = this->Entsize;
 
+  auto Write = [&](const DynamicReloc &Rel, uint8_t *Loc) {
+    auto *P = reinterpret_cast<Elf_Rela *>(Loc);
     if (Config->IsRela)
       P->r_addend = Rel.getAddend();
     P->r_offset = Rel.getOffset();
@@ -1239,16 +1299,100 @@ template <class ELFT> void RelocationSection<ELFT>::writeTo(uint8_t *Buf) {
       // in account 'local' and 'global' GOT entries.
       P->r_offset += InX::MipsGot->getTlsOffset();
     P->setSymbolAndType(Rel.getSymIndex(), Rel.Type, Config->IsMips64EL);
+  };
+
+  if (!Sort) {
+    parallelForEachN(0, NumChunks, [&](size_t C) {
+      size_t End = std::min(Relocs.size(), (C + 1) * ChunkSize);
+      for (size_t I = C * ChunkSize; I < End; ++I)
+        Write(Relocs[I], Buf + I * EntSize);
+    });
+    return;
   }
 
-  if (Sort) {
-    if (Config->IsRela)
-      std::stable_sort((Elf_Rela *)BufBegin,
-                       (Elf_Rela *)BufBegin + Relocs.size(),
-                       compRelocations<ELFT, Elf_Rela>);
-    else
-      std::stable_sort((Elf_Rel *)BufBegin, (Elf_Rel *)BufBegin + Relocs.size(),
-                       compRelocations<ELFT, Elf_Rel>);
+  std::vector<std::pair<uint64_t, uint32_t>> Keys(Relocs.size());
+  parallelForEachN(0, NumChunks, [&](size_t C) {
+    size_t End = std::min(Relocs.size(), (C + 1) * ChunkSize);
+    for (size_t I = C * ChunkSize; I < End; ++I) {
+      const DynamicReloc &Rel = Relocs[I];
+      uint64_t IsNotRelative = Rel.Type != Target->RelativeRel;
+      Keys[I] = {(IsNotRelative << 32) | Rel.getSymIndex(), I};
+    }
+  });
+
+  uint64_t MaxKey = 0;
+  for (const std::pair<uint64_t, uint32_t> &K : Keys)
+    MaxKey = std::max(MaxKey, K.first);
+  radixSort(Keys, MaxKey);
+
+  parallelForEachN(0, NumChunks, [&](size_t C) {
+    size_t End = std::min(Relocs.size(), (C + 1) * ChunkSize);
+    for (size_t I = C * ChunkSize; I < End; ++I)
+      Write(Relocs[Keys[I].second], Buf + I * EntSize);
+  });
+}
+
+template <class ELFT>
+RelrSection<ELFT>::RelrSection()
+    : SyntheticSection(SHF_ALLOC, SHT_RELR, Config->Wordsize, ".relr.dyn") {
+  this->Entsize = Config->Wordsize;
+}
+
+// Encodes the relative relocations. Each run of relocations starts with
+// the address of its first relocation. It is followed by bitmaps, each of
+// which covers the next 63 words (31 words for ELF32) after the previous
+// address or bitmap. Bit 0 of a bitmap is always 1 to tell it from an
+// address, and bit N (N > 0) is set if the N-th word is relocated.
+//
+// This depends on the addresses of the relocated locations, so it has to
+// be called again whenever addresses have changed.
+template <class ELFT> bool RelrSection<ELFT>::updateAllocSize() {
+  const size_t Wordsize = sizeof(Elf_Relr);
+  const size_t NBits = Wordsize * 8 - 1;
+  size_t OldSize = Entries.size();
+  Entries.clear();
+
+  std::vector<uint64_t> Offsets;
+  Offsets.reserve(Relocs.size());
+  for (const RelativeReloc &R : Relocs)
+    Offsets.push_back(R.InputSec->getOutputSection()->Addr +
+                      R.InputSec->getOffset(R.OffsetInSec));
+  std::sort(Offsets.begin(), Offsets.end());
+
+  for (size_t I = 0, E = Offsets.size(); I < E;) {
+    Entries.push_back(Offsets[I]);
+    uint64_t Base = Offsets[I] + Wordsize;
+    ++I;
+
+    // Fold the following relocations into bitmaps as long as they are
+    // word-aligned and close enough.
+    while (I < E) {
+      uint64_t Bitmap = 0;
+      for (; I < E; ++I) {
+        uint64_t Delta = Offsets[I] - Base;
+        if (Delta >= NBits * Wordsize || Delta % Wordsize)
+          break;
+        Bitmap |= uint64_t(1) << (Delta / Wordsize);
+      }
+      if (!Bitmap)
+        break;
+      Entries.push_back((Bitmap << 1) | 1);
+      Base += NBits * Wordsize;
+    }
+  }
+
+  // Don't let the section shrink. Otherwise, its size could oscillate
+  // forever as addresses move back and forth. An empty bitmap (1) is
+  // a valid entry that relocates nothing.
+  if (Entries.size() < OldSize)
+    Entries.resize(OldSize, 1);
+  return Entries.size() != OldSize;
+}
+
+template <class ELFT> void RelrSection<ELFT>::writeTo(uint8_t *Buf) {
+  for (Elf_Relr E : Entries) {
+    writeUint(Buf, E);
+    Buf += sizeof(Elf_Relr);
   }
 }
 
@@ -1734,7 +1878,7 @@ static std::vector<NameTypeEntry> readPubNamesAndTypes(DWARFContext &Dwarf,
     DWARFDebugPubTable PubTable(D, IsLE, true);
     for (const DWARFDebugPubTable::Set &Set : PubTable.getData())
       for (const DWARFDebugPubTable::Entry &Ent : Set.Entries)
-        Ret.push_back({Ent.Name, Ent.Descriptor.toBits()});
+        Ret.push_back({Ent.Name, hash(Ent.Name), Ent.Descriptor.toBits()});
   }
   return Ret;
 }
@@ -1753,31 +1897,74 @@ void GdbIndexSection::buildIndex() {
   if (V.empty())
     return;
 
-  for (InputSection *Sec : V)
-    Chunks.push_back(readDwarf(Sec));
+  // Reading DWARF is expensive. Each file has its own DWARF context,
+  // so we can read them in parallel.
+  Chunks.resize(V.size());
+  parallelForEachN(0, V.size(),
+                   [&](size_t I) { Chunks[I] = readDwarf(V[I]); });
 
+  createSymbols();
+}
+
+// Creates a list of unique names and their CU vectors. There may be
+// millions of names, so we split them into shards by hash value and
+// process the shards in parallel.
+void GdbIndexSection::createSymbols() {
+  // Compute the first CU index of each chunk.
+  std::vector<uint32_t> CuIdx(Chunks.size());
   uint32_t CuId = 0;
-  for (GdbIndexChunk &D : Chunks) {
-    for (AddressEntry &E : D.AddressArea)
-      E.CuIndex += CuId;
-
-    // Populate constant pool area.
-    for (NameTypeEntry &NameType : D.NamesAndTypes) {
-      uint32_t Hash = hash(NameType.Name);
-      size_t Offset = StringPool.add(NameType.Name);
-
-      bool IsNew;
-      GdbSymbol *Sym;
-      std::tie(IsNew, Sym) = SymbolTable.add(Hash, Offset);
-      if (IsNew) {
-        Sym->CuVectorIndex = CuVectors.size();
-        CuVectors.resize(CuVectors.size() + 1);
+  for (size_t I = 0, E = Chunks.size(); I != E; ++I) {
+    CuIdx[I] = CuId;
+    for (AddressEntry &Ent : Chunks[I].AddressArea)
+      Ent.CuIndex += CuId;
+    CuId += Chunks[I].CompilationUnits.size();
+  }
+
+  const size_t NumShards = 32;
+  std::vector<std::vector<GdbSymbol>> Shards(NumShards);
+
+  parallelForEachN(0, NumShards, [&](size_t Shard) {
+    std::vector<GdbSymbol> &Syms = Shards[Shard];
+    DenseMap<StringRef, size_t> Map;
+
+    for (size_t I = 0, E = Chunks.size(); I != E; ++I) {
+      ArrayRef<NameTypeEntry> Entries = Chunks[I].NamesAndTypes;
+      for (size_t J = 0, F = Entries.size(); J != F; ++J) {
+        const NameTypeEntry &Ent = Entries[J];
+        if (Ent.Hash % NumShards != Shard)
+          continue;
+
+        auto P = Map.insert({Ent.Name, Syms.size()});
+        if (P.second) {
+          Syms.emplace_back();
+          Syms.back().Name = Ent.Name;
+          Syms.back().NameHash = Ent.Hash;
+          Syms.back().FirstSeen = ((uint64_t)I << 32) | J;
+        }
+        Syms[P.first->second].CuVector.push_back(CuIdx[I] | (Ent.Type << 24));
       }
+    }
 
-      CuVectors[Sym->CuVectorIndex].insert(CuId | (NameType.Type << 24));
+    for (GdbSymbol &Sym : Syms) {
+      std::vector<uint32_t> &V = Sym.CuVector;
+      std::sort(V.begin(), V.end());
+      V.erase(std::unique(V.begin(), V.end()), V.end());
     }
+  });
 
-    CuId += D.CompilationUnits.size();
+  // Merge the shards. Sort names so that the output is deterministic.
+  for (std::vector<GdbSymbol> &Syms : Shards)
+    for (GdbSymbol &Sym : Syms)
+      Symbols.push_back(std::move(Sym));
+  std::sort(Symbols.begin(), Symbols.end(),
+            [](const GdbSymbol &A, const GdbSymbol &B) {
+              return A.FirstSeen < B.FirstSeen;
+            });
+
+  // Populate constant pool area.
+  for (size_t I = 0, E = Symbols.size(); I != E; ++I) {
+    Symbols[I].CuVectorIndex = I;
+    Symbols[I].NameOffset = StringPool.add(Symbols[I].Name);
   }
 }
 
@@ -1819,7 +2006,7 @@ void GdbIndexSection::finalizeContents() {
 
   buildIndex();
 
-  SymbolTable.finalizeContents();
+  SymbolTable.finalizeContents(Symbols);
 
   // GdbIndex header consist from version fields
   // and 5 more fields with different kinds of offsets.
@@ -1829,9 +2016,9 @@ void GdbIndexSection::finalizeContents() {
   ConstantPoolOffset =
       SymTabOffset + SymbolTable.getCapacity() * SymTabEntrySize;
 
-  for (std::set<uint32_t> &CuVec : CuVectors) {
+  for (GdbSymbol &Sym : Symbols) {
     CuVectorsOffset.push_back(CuVectorsSize);
-    CuVectorsSize += OffsetTypeSize * (CuVec.size() + 1);
+    CuVectorsSize += OffsetTypeSize * (Sym.CuVector.size() + 1);
   }
   StringPoolOffset = ConstantPoolOffset + CuVectorsSize;
 
@@ -1887,10 +2074,10 @@ void GdbIndexSection::writeTo(uint8_t *Buf) {
   }
 
   // Write the CU vectors into the constant pool.
-  for (std::set<uint32_t> &CuVec : CuVectors) {
-    write32le(Buf, CuVec.size());
+  for (GdbSymbol &Sym : Symbols) {
+    write32le(Buf, Sym.CuVector.size());
     Buf += 4;
-    for (uint32_t Val : CuVec) {
+    for (uint32_t Val : Sym.CuVector) {
       write32le(Buf, Val);
       Buf += 4;
     }
@@ -1903,6 +2090,318 @@ bool GdbIndexSection::empty() const {
   return !Out::DebugInfo;
 }
 
+// llvm/BinaryFormat/Dwarf.h doesn't define DWARF v5 name index
+// attributes yet.
+enum : uint32_t { DW_IDX_compile_unit = 1, DW_IDX_die_offset = 3 };
+
+// The header consists of 8 four-byte fields and 2 two-byte fields.
+static const size_t DebugNamesHeaderSize = 36;
+
+DebugNamesSection::DebugNamesSection()
+    : SyntheticSection(0, SHT_PROGBITS, 4, ".debug_names") {}
+
+// The hash function defined in the DWARF v5 spec.
+static uint32_t djbHash(StringRef S) {
+  uint32_t H = 5381;
+  for (uint8_t C : S)
+    H = H * 33 + C;
+  return H;
+}
+
+// Returns the number of hash buckets for a given number of names. This
+// is the same heuristic as LLVM uses.
+static uint32_t getBucketCount(size_t NumNames) {
+  if (NumNames > 1024)
+    return NumNames / 4;
+  if (NumNames > 16)
+    return NumNames / 2;
+  return std::max<uint32_t>(NumNames, 1);
+}
+
+DebugNamesSection::Chunk DebugNamesSection::readDwarf(InputSection *Sec) {
+  Expected<std::unique_ptr<object::ObjectFile>> Obj =
+      object::ObjectFile::createObjectFile(Sec->File->MB);
+  if (!Obj) {
+    error(toString(Sec->File) + ": error creating DWARF context");
+    return {};
+  }
+
+  DWARFContextInMemory Dwarf(*Obj.get());
+  Chunk Ret;
+
+  DenseMap<uint32_t, uint32_t> CuIdx;
+  for (std::unique_ptr<DWARFCompileUnit> &CU : Dwarf.compile_units()) {
+    CuIdx[CU->getOffset()] = Ret.CuOffsets.size();
+    Ret.CuOffsets.push_back(CU->getOffset());
+  }
+
+  StringRef Data[] = {Dwarf.getGnuPubNamesSection(),
+                      Dwarf.getGnuPubTypesSection()};
+  for (StringRef D : Data) {
+    DWARFDebugPubTable PubTable(D, Config->IsLE, true);
+    for (const DWARFDebugPubTable::Set &Set : PubTable.getData()) {
+      auto It = CuIdx.find(Set.Offset);
+      if (It == CuIdx.end())
+        continue;
+
+      // Pub tables don't tell us DIE tags, so we need to read DIEs.
+      DWARFCompileUnit *CU = Dwarf.getCompileUnitAtIndex(It->second);
+      for (const DWARFDebugPubTable::Entry &Ent : Set.Entries) {
+        DWARFDie Die = CU->getDIEForOffset(Set.Offset + Ent.SecOffset);
+        if (!Die)
+          continue;
+        Ret.Names.push_back({Ent.Name, djbHash(Ent.Name), It->second,
+                             Ent.SecOffset, (uint32_t)Die.getTag()});
+      }
+    }
+  }
+  return Ret;
+}
+
+// Creates a list of unique names and DIEs that they refer to. Names are
+// split into shards by hash value, and shards are processed in parallel,
+// in the same way as GdbIndexSection does.
+void DebugNamesSection::createNames(std::vector<Chunk> &Chunks) {
+  std::vector<uint32_t> CuIdx(Chunks.size());
+  for (size_t I = 0, E = Chunks.size(); I != E; ++I)
+    CuIdx[I] = (I == 0) ? 0 : CuIdx[I - 1] + Chunks[I - 1].CuOffsets.size();
+
+  const size_t NumShards = 32;
+  std::vector<std::vector<DebugName>> Shards(NumShards);
+
+  parallelForEachN(0, NumShards, [&](size_t Shard) {
+    std::vector<DebugName> &V = Shards[Shard];
+    DenseMap<StringRef, size_t> Map;
+
+    for (size_t I = 0, E = Chunks.size(); I != E; ++I) {
+      ArrayRef<NameEntry> Entries = Chunks[I].Names;
+      for (size_t J = 0, F = Entries.size(); J != F; ++J) {
+        const NameEntry &Ent = Entries[J];
+        if (Ent.Hash % NumShards != Shard)
+          continue;
+
+        auto P = Map.insert({Ent.Name, V.size()});
+        if (P.second) {
+          V.emplace_back();
+          V.back().Name = Ent.Name;
+          V.back().Hash = Ent.Hash;
+          V.back().FirstSeen = ((uint64_t)I << 32) | J;
+        }
+        V[P.first->second].Entries.push_back(
+            {CuIdx[I] + Ent.CuIndex, Ent.DieOffset, Ent.Tag});
+      }
+    }
+
+    for (DebugName &Name : V) {
+      std::vector<DieEntry> &Ents = Name.Entries;
+      std::sort(Ents.begin(), Ents.end(),
+                [](const DieEntry &A, const DieEntry &B) {
+                  return std::tie(A.CuIndex, A.DieOffset) <
+                         std::tie(B.CuIndex, B.DieOffset);
+                });
+      Ents.erase(std::unique(Ents.begin(), Ents.end(),
+                             [](const DieEntry &A, const DieEntry &B) {
+                               return A.CuIndex == B.CuIndex &&
+                                      A.DieOffset == B.DieOffset;
+                             }),
+                 Ents.end());
+    }
+  });
+
+  for (std::vector<DebugName> &V : Shards)
+    for (DebugName &Name : V)
+      Names.push_back(std::move(Name));
+
+  // The name table is sorted by hash bucket. Sort names in the same
+  // bucket by hash value and then by first occurrence, so that the
+  // output is deterministic.
+  BucketCount = getBucketCount(Names.size());
+  std::sort(Names.begin(), Names.end(),
+            [&](const DebugName &A, const DebugName &B) {
+              return std::make_tuple(A.Hash % BucketCount, A.Hash,
+                                     A.FirstSeen) <
+                     std::make_tuple(B.Hash % BucketCount, B.Hash,
+                                     B.FirstSeen);
+            });
+}
+
+// Finds names in .debug_str. Names that are not found are appended to
+// .debug_str by DebugNamesStrSection.
+void DebugNamesSection::assignStringOffsets() {
+  DenseMap<StringRef, uint32_t> Map;
+  for (size_t I = 0, E = Names.size(); I != E; ++I)
+    Map[Names[I].Name] = I;
+
+  for (InputSectionBase *S : InputSections) {
+    auto *Sec = dyn_cast<MergeSyntheticSection>(S);
+    if (!Sec || Sec->Name != ".debug_str")
+      continue;
+
+    // Strings in a MergeSyntheticSection are unique, so each name is
+    // found at most once in this loop.
+    ArrayRef<std::pair<size_t, StringRef>> V = Sec->getContents();
+    parallelForEach(V.begin(), V.end(),
+                    [&](const std::pair<size_t, StringRef> &P) {
+                      StringRef S = P.second;
+                      if (S.empty() || S.back() != '\0')
+                        return;
+                      auto It = Map.find(S.drop_back());
+                      if (It == Map.end())
+                        return;
+                      DebugName &Name = Names[It->second];
+                      if (!Name.StrSec) {
+                        Name.StrSec = Sec;
+                        Name.StrOffset = P.first;
+                      }
+                    });
+  }
+
+  for (DebugName &Name : Names) {
+    if (Name.StrSec)
+      continue;
+    Name.StrSec = InX::DebugNamesStr;
+    Name.StrOffset = ExtraStringsSize;
+    ExtraStrings.push_back(Name.Name);
+    ExtraStringsSize += Name.Name.size() + 1;
+  }
+}
+
+void DebugNamesSection::finalizeContents() {
+  if (Finalized)
+    return;
+  Finalized = true;
+
+  std::vector<InputSection *> Sections = getDebugInfoSections();
+  std::vector<Chunk> Chunks(Sections.size());
+  parallelForEachN(0, Sections.size(),
+                   [&](size_t I) { Chunks[I] = readDwarf(Sections[I]); });
+
+  for (size_t I = 0, E = Sections.size(); I != E; ++I)
+    for (uint32_t Off : Chunks[I].CuOffsets)
+      Cus.push_back({Sections[I], Off});
+
+  createNames(Chunks);
+  assignStringOffsets();
+
+  // Create an abbreviation for each DIE tag. Every entry consists of
+  // a CU index and a DIE offset.
+  std::vector<uint32_t> Tags;
+  for (DebugName &Name : Names)
+    for (DieEntry &Ent : Name.Entries)
+      Tags.push_back(Ent.Tag);
+  std::sort(Tags.begin(), Tags.end());
+  Tags.erase(std::unique(Tags.begin(), Tags.end()), Tags.end());
+
+  for (uint32_t Tag : Tags) {
+    uint32_t Code = Abbrevs.size() + 1;
+    Abbrevs[Tag] = Code;
+    AbbrevTableSize += getULEB128Size(Code) + getULEB128Size(Tag) +
+                       getULEB128Size(DW_IDX_compile_unit) +
+                       getULEB128Size(DW_FORM_data4) +
+                       getULEB128Size(DW_IDX_die_offset) +
+                       getULEB128Size(DW_FORM_ref4) + 2;
+  }
+  AbbrevTableSize += 1;
+
+  for (DebugName &Name : Names) {
+    Name.EntryOffset = EntryPoolSize;
+    for (DieEntry &Ent : Name.Entries)
+      EntryPoolSize += getULEB128Size(Abbrevs[Ent.Tag]) + 8;
+    EntryPoolSize += 1;
+  }
+
+  Size = DebugNamesHeaderSize + Cus.size() * 4 + BucketCount * 4 +
+         Names.size() * 12 + AbbrevTableSize + EntryPoolSize;
+}
+
+size_t DebugNamesSection::getSize() const { return Size; }
+
+void DebugNamesSection::writeTo(uint8_t *Buf) {
+  endianness E = Config->Endianness;
+
+  // Write the header.
+  write32(Buf, Size - 4, E);         // Unit length
+  write16(Buf + 4, 5, E);            // Version
+  write16(Buf + 6, 0, E);            // Padding
+  write32(Buf + 8, Cus.size(), E);   // Compilation unit count
+  write32(Buf + 12, 0, E);           // Local type unit count
+  write32(Buf + 16, 0, E);           // Foreign type unit count
+  write32(Buf + 20, BucketCount, E); // Bucket count
+  write32(Buf + 24, Names.size(), E);
+  write32(Buf + 28, AbbrevTableSize, E);
+  write32(Buf + 32, 0, E); // Augmentation string size
+  Buf += DebugNamesHeaderSize;
+
+  // Write the CU list.
+  for (std::pair<InputSection *, uint32_t> &P : Cus) {
+    write32(Buf, P.first->OutSecOff + P.second, E);
+    Buf += 4;
+  }
+
+  // Write the hash buckets. A bucket has the 1-based index of the first
+  // name in the bucket, or 0 if the bucket is empty.
+  memset(Buf, 0, BucketCount * 4);
+  for (size_t I = Names.size(); I != 0; --I)
+    write32(Buf + (Names[I - 1].Hash % BucketCount) * 4, I, E);
+  Buf += BucketCount * 4;
+
+  // Write the hashes, string offsets and entry offsets.
+  uint8_t *Hashes = Buf;
+  uint8_t *StrOffsets = Hashes + Names.size() * 4;
+  uint8_t *EntryOffsets = StrOffsets + Names.size() * 4;
+  for (size_t I = 0; I < Names.size(); ++I) {
+    DebugName &Name = Names[I];
+    write32(Hashes + I * 4, Name.Hash, E);
+    write32(StrOffsets + I * 4, Name.StrSec->OutSecOff + Name.StrOffset, E);
+    write32(EntryOffsets + I * 4, Name.EntryOffset, E);
+  }
+  Buf = EntryOffsets + Names.size() * 4;
+
+  // Write the abbreviation table.
+  for (std::pair<uint32_t, uint32_t> &P : Abbrevs) {
+    Buf += encodeULEB128(P.second, Buf);
+    Buf += encodeULEB128(P.first, Buf);
+    Buf += encodeULEB128(DW_IDX_compile_unit, Buf);
+    Buf += encodeULEB128(DW_FORM_data4, Buf);
+    Buf += encodeULEB128(DW_IDX_die_offset, Buf);
+    Buf += encodeULEB128(DW_FORM_ref4, Buf);
+    *Buf++ = 0;
+    *Buf++ = 0;
+  }
+  *Buf++ = 0;
+
+  // Write the entry pool.
+  for (DebugName &Name : Names) {
+    for (DieEntry &Ent : Name.Entries) {
+      Buf += encodeULEB128(Abbrevs[Ent.Tag], Buf);
+      write32(Buf, Ent.CuIndex, E);
+      write32(Buf + 4, Ent.DieOffset, E);
+      Buf += 8;
+    }
+    *Buf++ = 0;
+  }
+}
+
+bool DebugNamesSection::empty() const { return !Out::DebugInfo; }
+
+DebugNamesStrSection::DebugNamesStrSection()
+    : SyntheticSection(0, SHT_PROGBITS, 1, ".debug_str") {}
+
+// The size is known after Writer finalizes DebugNamesSection, which is
+// done right after input sections are assigned to output sections.
+size_t DebugNamesStrSection::getSize() const {
+  return InX::DebugNames->ExtraStringsSize;
+}
+
+void DebugNamesStrSection::writeTo(uint8_t *Buf) {
+  for (StringRef S : InX::DebugNames->ExtraStrings) {
+    memcpy(Buf, S.data(), S.size());
+    Buf += S.size() + 1;
+  }
+}
+
+bool DebugNamesStrSection::empty() const { return !Out::DebugInfo; }
+
 template <class ELFT>
 EhFrameHeader<ELFT>::EhFrameHeader()
     : SyntheticSection(SHF_ALLOC, SHT_PROGBITS, 1, ".eh_frame_hdr") {}
@@ -2128,64 +2627,269 @@ template <class ELFT> bool VersionNeedSection<ELFT>::empty() const {
   return getNeedNum() == 0;
 }
 
-MergeSyntheticSection::MergeSyntheticSection(StringRef Name, uint32_t Type,
-                                             uint64_t Flags, uint32_t Alignment)
-    : SyntheticSection(Flags, Type, Alignment, Name),
-      Builder(StringTableBuilder::RAW, Alignment) {}
-
 void MergeSyntheticSection::addSection(MergeInputSection *MS) {
   MS->Parent = this;
   Sections.push_back(MS);
 }
 
-void MergeSyntheticSection::writeTo(uint8_t *Buf) { Builder.write(Buf); }
+constexpr size_t MergeSyntheticSection::NumShards;
 
-bool MergeSyntheticSection::shouldTailMerge() const {
-  return (this->Flags & SHF_STRINGS) && Config->Optimize >= 2;
+void MergeSyntheticSection::writeTo(uint8_t *Buf) {
+  parallelForEach(Contents.begin(), Contents.end(),
+                  [&](const std::pair<size_t, StringRef> &P) {
+                    memcpy(Buf + P.first, P.second.data(), P.second.size());
+                  });
 }
 
-void MergeSyntheticSection::finalizeTailMerge() {
-  // Add all string pieces to the string table builder to create section
-  // contents.
-  for (MergeInputSection *Sec : Sections)
-    for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I)
-      if (Sec->Pieces[I].Live)
-        Builder.add(Sec->getData(I));
+// Returns the number of threads to process shards. Must be a power of 2
+// to avoid expensive modulo operations in tight loops.
+static size_t getShardConcurrency(size_t NumShards) {
+  if (!Config->Threads)
+    return 1;
+  return PowerOf2Floor(std::min<size_t>(hardware_concurrency(), NumShards));
+}
+
+// Returns the Pos'th character from the end of S, or -1 if S is too short.
+static int charTailAt(StringRef S, size_t Pos) {
+  if (Pos >= S.size())
+    return -1;
+  return (unsigned char)S[S.size() - Pos - 1];
+}
+
+// Three-way radix quicksort on reversed strings. This is the same
+// algorithm as the one in StringTableBuilder. Strings whose characters
+// are greater come first, and a string comes after the strings it is a
+// suffix of. Because input strings are unique, the order is total.
+static void sortByTail(ArrayRef<StringRef> Strings, uint32_t *Begin,
+                       uint32_t *End, size_t Pos) {
+  while (End - Begin > 1) {
+    // Partition items so that items in [Begin, P) are greater than the
+    // pivot, [P, Q) are the same as the pivot, and [Q, End) are less
+    // than the pivot.
+    int Pivot = charTailAt(Strings[*Begin], Pos);
+    uint32_t *P = Begin;
+    uint32_t *Q = End;
+    for (uint32_t *R = Begin + 1; R < Q;) {
+      int C = charTailAt(Strings[*R], Pos);
+      if (C > Pivot)
+        std::swap(*P++, *R++);
+      else if (C < Pivot)
+        std::swap(*--Q, *R);
+      else
+        R++;
+    }
 
-  // Fix the string table content. After this, the contents will never change.
-  Builder.finalize();
+    sortByTail(Strings, Begin, P, Pos);
+    sortByTail(Strings, Q, End, Pos);
+    if (Pivot == -1)
+      return;
 
-  // finalize() fixed tail-optimized strings, so we can now get
-  // offsets of strings. Get an offset for each string and save it
-  // to a corresponding StringPiece for easy access.
-  for (MergeInputSection *Sec : Sections)
-    for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I)
-      if (Sec->Pieces[I].Live)
-        Sec->Pieces[I].OutputOff = Builder.getOffset(Sec->getData(I));
+    // Sort strings of the same pivot with the next character.
+    Begin = P;
+    End = Q;
+    ++Pos;
+  }
 }
 
-void MergeSyntheticSection::finalizeNoTailMerge() {
-  // Add all string pieces to the string table builder to create section
-  // contents. Because we are not tail-optimizing, offsets of strings are
-  // fixed when they are added to the builder (string table builder contains
-  // a hash table from strings to offsets).
-  for (MergeInputSection *Sec : Sections)
-    for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I)
-      if (Sec->Pieces[I].Live)
-        Sec->Pieces[I].OutputOff = Builder.add(Sec->getData(I));
+// Tail merging needs strings to be sorted by their reversed contents,
+// which used to be the most time-consuming single-threaded part of -O2
+// links. We do it in parallel in the following steps.
+//
+//  1. Deduplicate pieces using hash shards, as MergeNoTailSection does.
+//
+//  2. Partition unique strings into buckets by their last two characters
+//     (ignoring a suffix shared by all strings, which is usually the
+//     terminating null character) and sort the buckets concurrently.
+//     Buckets are ordered so that their concatenation is fully sorted.
+//
+//  3. Stitch. In the sorted order, a string can be merged into the last
+//     non-merged string if and only if it is a suffix of the string just
+//     before it, so we can compute that in parallel too. Only a cheap
+//     linear pass to assign offsets remains serial.
+void MergeTailSection::finalizeContents() {
+  // Step 1. Each piece's OutputOff temporarily holds an index in a shard.
+  std::vector<DenseMap<CachedHashStringRef, uint32_t>> Maps(NumShards);
+  std::vector<std::vector<StringRef>> ShardStrings(NumShards);
+  size_t Concurrency = getShardConcurrency(NumShards);
+
+  parallelForEachN(0, Concurrency, [&](size_t ThreadId) {
+    for (MergeInputSection *Sec : Sections) {
+      for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
+        size_t ShardId = getShardId(Sec->getHash(I));
+        if ((ShardId & (Concurrency - 1)) != ThreadId || !Sec->Pieces[I].Live)
+          continue;
+        CachedHashStringRef S = Sec->getData(I);
+        auto P = Maps[ShardId].insert({S, ShardStrings[ShardId].size()});
+        if (P.second)
+          ShardStrings[ShardId].push_back(S.val());
+        Sec->Pieces[I].OutputOff = P.first->second;
+      }
+    }
+  });
+  Maps.clear();
+
+  size_t ShardBase[NumShards];
+  std::vector<StringRef> Strings;
+  for (size_t I = 0; I < NumShards; ++I) {
+    ShardBase[I] = Strings.size();
+    Strings.insert(Strings.end(), ShardStrings[I].begin(),
+                   ShardStrings[I].end());
+  }
+  ShardStrings.clear();
+  if (Strings.empty())
+    return;
+
+  // Step 2. Compute the length of the suffix shared by all strings.
+  StringRef First = Strings[0];
+  size_t Skip = First.size();
+  for (StringRef S : Strings) {
+    size_t N = 0;
+    size_t Max = std::min(Skip, S.size());
+    while (N < Max && S[S.size() - N - 1] == First[First.size() - N - 1])
+      ++N;
+    Skip = N;
+  }
+
+  // Greater characters come first, so bucket IDs are in reverse order
+  // of the characters. -1 (i.e. no character) comes last.
+  const size_t NumBuckets = 257 * 257;
+  auto GetBucket = [&](StringRef S) -> size_t {
+    size_t Key =
+        (charTailAt(S, Skip) + 1) * 257 + (charTailAt(S, Skip + 1) + 1);
+    return NumBuckets - 1 - Key;
+  };
+
+  // Counting-sort string indices into buckets.
+  std::vector<size_t> Begins(NumBuckets + 1);
+  for (StringRef S : Strings)
+    ++Begins[GetBucket(S) + 1];
+  for (size_t I = 1; I <= NumBuckets; ++I)
+    Begins[I] += Begins[I - 1];
+
+  std::vector<uint32_t> Order(Strings.size());
+  {
+    std::vector<size_t> Pos(Begins.begin(), Begins.end() - 1);
+    for (size_t I = 0, E = Strings.size(); I != E; ++I)
+      Order[Pos[GetBucket(Strings[I])]++] = I;
+  }
+
+  // All strings in a bucket share their last Skip+2 characters.
+  parallelForEachN(0, NumBuckets, [&](size_t B) {
+    sortByTail(Strings, Order.data() + Begins[B], Order.data() + Begins[B + 1],
+               Skip + 2);
+  });
+
+  // Step 3.
+  std::vector<uint8_t> IsTail(Order.size());
+  parallelForEachN(1, Order.size(), [&](size_t I) {
+    IsTail[I] = Strings[Order[I - 1]].endswith(Strings[Order[I]]);
+  });
+
+  std::vector<size_t> Offsets(Strings.size());
+  size_t Off = 0;
+  for (size_t I = 0, E = Order.size(); I != E; ++I) {
+    StringRef S = Strings[Order[I]];
+    if (IsTail[I]) {
+      size_t Pos = Off - S.size();
+      if (!(Pos & (Alignment - 1))) {
+        Offsets[Order[I]] = Pos;
+        continue;
+      }
+    }
 
-  Builder.finalizeInOrder();
+    Off = alignTo(Off, Alignment);
+    Offsets[Order[I]] = Off;
+    Contents.push_back({Off, S});
+    Off += S.size();
+  }
+  Size = Off;
+
+  // Now that we know string offsets, set them to pieces.
+  parallelForEach(Sections.begin(), Sections.end(),
+                  [&](MergeInputSection *Sec) {
+                    for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
+                      SectionPiece &Piece = Sec->Pieces[I];
+                      if (Piece.Live)
+                        Piece.OutputOff =
+                            Offsets[ShardBase[getShardId(Sec->getHash(I))] +
+                                    Piece.OutputOff];
+                    }
+                  });
 }
 
-void MergeSyntheticSection::finalizeContents() {
-  if (shouldTailMerge())
-    finalizeTailMerge();
-  else
-    finalizeNoTailMerge();
+// This function is very hot (i.e. it can take several seconds to finish)
+// because sometimes the number of inputs is in an order of magnitude of
+// millions. So, we use multi-threading.
+//
+// For any strings S and T, we know S is not mergeable with T if S's hash
+// value is different from T's. If that's the case, we can safely put S and
+// T into different hash tables without worrying about merge misses. We
+// use a fixed number of hash tables (shards) and deduplicate pieces of
+// different shards in parallel.
+//
+// Each shard is owned by exactly one thread, and a thread visits pieces
+// in input order, so the first occurrence of each string always wins no
+// matter how many threads we use. Output offsets are then assigned to the
+// first occurrences in input order, which gives the same layout as
+// StringTableBuilder::finalizeInOrder().
+void MergeNoTailSection::finalizeContents() {
+  std::vector<DenseMap<CachedHashStringRef, SectionPiece *>> Maps(NumShards);
+  size_t Concurrency = getShardConcurrency(NumShards);
+
+  // Find the first occurrence of each piece. A first occurrence gets an
+  // OutputOff of 0 for now, and duplicates keep -1.
+  parallelForEachN(0, Concurrency, [&](size_t ThreadId) {
+    for (MergeInputSection *Sec : Sections) {
+      for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
+        size_t ShardId = getShardId(Sec->getHash(I));
+        if ((ShardId & (Concurrency - 1)) != ThreadId || !Sec->Pieces[I].Live)
+          continue;
+        if (Maps[ShardId].insert({Sec->getData(I), &Sec->Pieces[I]}).second)
+          Sec->Pieces[I].OutputOff = 0;
+      }
+    }
+  });
+
+  // Assign offsets to first occurrences. This is a linear scan without
+  // any hash table lookups.
+  size_t Off = 0;
+  for (MergeInputSection *Sec : Sections) {
+    for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
+      SectionPiece &Piece = Sec->Pieces[I];
+      if (!Piece.Live || Piece.OutputOff == -1)
+        continue;
+      StringRef S = Sec->getData(I).val();
+      Off = alignTo(Off, Alignment);
+      Piece.OutputOff = Off;
+      Contents.push_back({Off, S});
+      Off += S.size();
+    }
+  }
+  Size = Off;
+
+  // Let duplicates share the offsets of their first occurrences.
+  parallelForEachN(0, Concurrency, [&](size_t ThreadId) {
+    for (MergeInputSection *Sec : Sections) {
+      for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
+        size_t ShardId = getShardId(Sec->getHash(I));
+        SectionPiece &Piece = Sec->Pieces[I];
+        if ((ShardId & (Concurrency - 1)) != ThreadId || !Piece.Live ||
+            Piece.OutputOff != -1)
+          continue;
+        Piece.OutputOff = Maps[ShardId].lookup(Sec->getData(I))->OutputOff;
+      }
+    }
+  });
 }
 
-size_t MergeSyntheticSection::getSize() const {
-  return Builder.getSize();
+static MergeSyntheticSection *createMergeSynthetic(StringRef Name,
+                                                   uint32_t Type,
+                                                   uint64_t Flags,
+                                                   uint32_t Alignment) {
+  bool ShouldTailMerge = (Flags & SHF_STRINGS) && Config->Optimize >= 2;
+  if (ShouldTailMerge)
+    return make<MergeTailSection>(Name, Type, Flags, Alignment);
+  return make<MergeNoTailSection>(Name, Type, Flags, Alignment);
 }
 
 // This function decompresses compressed sections and scans over the input
@@ -2194,9 +2898,15 @@ size_t MergeSyntheticSection::getSize() const {
 // sections at the location of the first input section that it replaces. It then
 // finalizes each synthetic section in order to compute an output offset for
 // each piece of each input section.
+static Timer MergeTimer("Merge sections", Timer::root());
+static Timer SplitTimer("Decompress and split sections", MergeTimer);
+
 void elf::decompressAndMergeSections() {
+  ScopedTimer T(MergeTimer);
+
   // splitIntoPieces needs to be called on each MergeInputSection before calling
   // finalizeContents(). Do that first.
+  ScopedTimer T2(SplitTimer);
   parallelForEach(InputSections.begin(), InputSections.end(),
                   [](InputSectionBase *S) {
                     if (!S->Live)
@@ -2206,6 +2916,7 @@ void elf::decompressAndMergeSections() {
                     if (auto *MS = dyn_cast<MergeInputSection>(S))
                       MS->splitIntoPieces();
                   });
+  T2.stop();
 
   std::vector<MergeSyntheticSection *> MergeSections;
   for (InputSectionBase *&S : InputSections) {
@@ -2228,7 +2939,7 @@ void elf::decompressAndMergeSections() {
     });
     if (I == MergeSections.end()) {
       MergeSyntheticSection *Syn =
-          make<MergeSyntheticSection>(OutsecName, MS->Type, Flags, Alignment);
+          createMergeSynthetic(OutsecName, MS->Type, Flags, Alignment);
       MergeSections.push_back(Syn);
       I = std::prev(MergeSections.end());
       S = Syn;
@@ -2237,8 +2948,10 @@ void elf::decompressAndMergeSections() {
     }
     (*I)->addSection(MS);
   }
-  for (auto *MS : MergeSections)
+  for (auto *MS : MergeSections) {
     MS->finalizeContents();
+    MS->freeHashes();
+  }
 
   std::vector<InputSectionBase *> &V = InputSections;
   V.erase(std::remove(V.begin(), V.end(), nullptr), V.end());
@@ -2298,6 +3011,8 @@ void ThunkSection::writeTo(uint8_t *Buf) {
 }
 
 InputSection *ThunkSection::getTargetInputSection() const {
+  if (Thunks.empty())
+    return nullptr;
   const Thunk *T = Thunks.front();
   return T->getTargetInputSection();
 }
@@ -2307,6 +3022,8 @@ BssSection *InX::Bss;
 BssSection *InX::BssRelRo;
 BuildIdSection *InX::BuildId;
 InputSection *InX::Common;
+DebugNamesSection *InX::DebugNames;
+DebugNamesStrSection *InX::DebugNamesStr;
 SyntheticSection *InX::Dynamic;
 StringTableSection *InX::DynStrTab;
 SymbolTableBaseSection *InX::DynSymTab;
@@ -2364,6 +3081,11 @@ template class elf::RelocationSection<ELF32BE>;
 template class elf::RelocationSection<ELF64LE>;
 template class elf::RelocationSection<ELF64BE>;
 
+template class elf::RelrSection<ELF32LE>;
+template class elf::RelrSection<ELF32BE>;
+template class elf::RelrSection<ELF64LE>;
+template class elf::RelrSection<ELF64BE>;
+
 template class elf::SymbolTableSection<ELF32LE>;
 template class elf::SymbolTableSection<ELF32BE>;
 template class elf::SymbolTableSection<ELF64LE>;
@@ -26,8 +26,7 @@
 #include "InputSection.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/MC/StringTableBuilder.h"
-
-#include <set>
+#include "llvm/Support/MathExtras.h"
 
 namespace lld {
 namespace elf {
@@ -46,8 +45,9 @@ public:
   virtual size_t getSize() const = 0;
   virtual void finalizeContents() {}
   // If the section has the SHF_ALLOC flag and the size may be changed if
-  // thunks are added, update the section size.
-  virtual void updateAllocSize() {}
+  // thunks are added or addresses change, update the section size. Returns
+  // true if the size has changed.
+  virtual bool updateAllocSize() { return false; }
   // If any additional finalization of contents are needed post thunk creation.
   virtual void postThunkContents() {}
   virtual bool empty() const { return false; }
@@ -173,7 +173,7 @@ public:
   MipsGotSection();
   void writeTo(uint8_t *Buf) override;
   size_t getSize() const override { return Size; }
-  void updateAllocSize() override;
+  bool updateAllocSize() override;
   void finalizeContents() override;
   bool empty() const override;
   void addEntry(SymbolBody &Sym, int64_t Addend, RelExpr Expr);
@@ -398,6 +398,35 @@ private:
   std::vector<DynamicReloc> Relocs;
 };
 
+// A packed relative relocation section, .relr.dyn, which is created if
+// --pack-dyn-relocs=relr is given. It replaces R_*_RELATIVE relocations
+// in .rela.dyn with a list of words. An even word is the address of a
+// relocation, and an odd word is a bitmap of the following words that also
+// need to be relocated. Like Elf_Rel, it has no addends; they are written
+// to the relocated locations instead.
+template <class ELFT> class RelrSection final : public SyntheticSection {
+  typedef typename ELFT::uint Elf_Relr;
+
+public:
+  RelrSection();
+  void addReloc(const InputSectionBase *InputSec, uint64_t OffsetInSec) {
+    Relocs.push_back({InputSec, OffsetInSec});
+  }
+  bool updateAllocSize() override;
+  size_t getSize() const override { return Entries.size() * sizeof(Elf_Relr); }
+  void writeTo(uint8_t *Buf) override;
+  bool empty() const override { return Relocs.empty(); }
+
+private:
+  struct RelativeReloc {
+    const InputSectionBase *InputSec;
+    uint64_t OffsetInSec;
+  };
+
+  std::vector<RelativeReloc> Relocs;
+  std::vector<Elf_Relr> Entries;
+};
+
 struct SymbolTableEntry {
   SymbolBody *Symbol;
   size_t StrTabOffset;
@@ -513,8 +542,9 @@ public:
   // It is the area of gdb index.
   GdbHashTab SymbolTable;
 
-  // CU vector is a part of constant pool area of section.
-  std::vector<std::set<uint32_t>> CuVectors;
+  // Unique names in the order they first appear in input files. Their
+  // CU vectors are a part of constant pool area of section.
+  std::vector<GdbSymbol> Symbols;
 
   // String pool is also a part of constant pool, it follows CU vectors.
   llvm::StringTableBuilder StringPool;
@@ -526,6 +556,7 @@ public:
 private:
   GdbIndexChunk readDwarf(InputSection *Sec);
   void buildIndex();
+  void createSymbols();
 
   uint32_t CuTypesOffset;
   uint32_t SymTabOffset;
@@ -538,6 +569,87 @@ private:
   bool Finalized = false;
 };
 
+// The .debug_names section is a DWARF v5 accelerator table that maps
+// names to DIEs. We create it from .debug_gnu_pub{names,types} sections,
+// which are the same per-object name indexes as .gdb_index is created
+// from. The format is described in section 6.1.1 of the DWARF v5 spec.
+class DebugNamesSection final : public SyntheticSection {
+public:
+  DebugNamesSection();
+  void finalizeContents() override;
+  void writeTo(uint8_t *Buf) override;
+  size_t getSize() const override;
+  bool empty() const override;
+
+  // Names in the table refer to strings in .debug_str. Names that are
+  // not in .debug_str yet are appended to it by DebugNamesStrSection.
+  std::vector<StringRef> ExtraStrings;
+  size_t ExtraStringsSize = 0;
+
+private:
+  struct NameEntry {
+    StringRef Name;
+    uint32_t Hash;
+    uint32_t CuIndex;
+    uint32_t DieOffset;
+    uint32_t Tag;
+  };
+
+  // Information read from a .debug_info section of a single object.
+  struct Chunk {
+    std::vector<uint32_t> CuOffsets;
+    std::vector<NameEntry> Names;
+  };
+
+  struct DieEntry {
+    uint32_t CuIndex;
+    uint32_t DieOffset;
+    uint32_t Tag;
+  };
+
+  struct DebugName {
+    StringRef Name;
+    uint32_t Hash;
+    uint64_t FirstSeen;
+    std::vector<DieEntry> Entries;
+
+    // The string's offset in StrSec, which is a part of .debug_str.
+    InputSection *StrSec = nullptr;
+    uint64_t StrOffset = 0;
+
+    // Offset of the first entry in the entry pool.
+    uint32_t EntryOffset = 0;
+  };
+
+  Chunk readDwarf(InputSection *Sec);
+  void createNames(std::vector<Chunk> &Chunks);
+  void assignStringOffsets();
+
+  // Compilation units and their offsets in input .debug_info sections.
+  std::vector<std::pair<InputSection *, uint32_t>> Cus;
+
+  // Names sorted by hash bucket.
+  std::vector<DebugName> Names;
+  uint32_t BucketCount = 0;
+
+  // DIE tags and their abbreviation codes.
+  llvm::MapVector<uint32_t, uint32_t> Abbrevs;
+
+  uint32_t AbbrevTableSize = 0;
+  uint32_t EntryPoolSize = 0;
+  size_t Size = 0;
+  bool Finalized = false;
+};
+
+// Names appended to .debug_str for .debug_names.
+class DebugNamesStrSection final : public SyntheticSection {
+public:
+  DebugNamesStrSection();
+  void writeTo(uint8_t *Buf) override;
+  size_t getSize() const override;
+  bool empty() const override;
+};
+
 // --eh-frame-hdr option tells linker to construct a header for all the
 // .eh_frame sections. This header is placed to a section named .eh_frame_hdr
 // and also to a PT_GNU_EH_FRAME segment.
@@ -637,22 +749,80 @@ public:
 // with different attributes in a single output sections. To do that
 // we put them into MergeSyntheticSection synthetic input sections which are
 // attached to regular output sections.
-class MergeSyntheticSection final : public SyntheticSection {
+class MergeSyntheticSection : public SyntheticSection {
 public:
-  MergeSyntheticSection(StringRef Name, uint32_t Type, uint64_t Flags,
-                        uint32_t Alignment);
   void addSection(MergeInputSection *MS);
+  size_t getSize() const override { return Size; }
   void writeTo(uint8_t *Buf) override;
-  void finalizeContents() override;
-  bool shouldTailMerge() const;
-  size_t getSize() const override;
 
-private:
-  void finalizeTailMerge();
-  void finalizeNoTailMerge();
+  ArrayRef<std::pair<size_t, StringRef>> getContents() const {
+    return Contents;
+  }
+
+  // Releases per-piece hash values of the input sections. Called after
+  // finalizeContents() because they are no longer needed.
+  void freeHashes() {
+    for (MergeInputSection *Sec : Sections)
+      Sec->freeHashes();
+  }
+
+  // No other synthetic section has SHF_MERGE.
+  static bool classof(const SectionBase *D) {
+    return D->kind() == InputSectionBase::Synthetic &&
+           (D->Flags & llvm::ELF::SHF_MERGE);
+  }
+
+protected:
+  MergeSyntheticSection(StringRef Name, uint32_t Type, uint64_t Flags,
+                        uint32_t Alignment)
+      : SyntheticSection(Flags, Type, Alignment, Name) {}
+
+  // We use the most significant bits of a hash as a shard ID.
+  // The reason why we don't want to use the least significant bits is
+  // because DenseMap also uses lower bits to determine a bucket ID.
+  // If we use lower bits, it significantly increases the probability of
+  // hash collisons.
+  static size_t getShardId(uint32_t Hash) {
+    return Hash >> (32 - llvm::countTrailingZeros(NumShards));
+  }
 
-  llvm::StringTableBuilder Builder;
   std::vector<MergeInputSection *> Sections;
+
+  // Section size
+  size_t Size = 0;
+
+  // Strings that are copied to the output and their output offsets.
+  // Strings merged into other strings are not in this vector.
+  std::vector<std::pair<size_t, StringRef>> Contents;
+
+  // Pieces are deduplicated in parallel using a fixed number of hash
+  // tables (shards). The number is a constant so that the result doesn't
+  // depend on the number of threads.
+  constexpr static size_t NumShards = 32;
+};
+
+// A MergeSyntheticSection for SHF_STRINGS sections with -O2. Strings that
+// are suffixes of other strings are merged into them (tail merging).
+// The layout is the same as StringTableBuilder::finalize() would create.
+class MergeTailSection final : public MergeSyntheticSection {
+public:
+  MergeTailSection(StringRef Name, uint32_t Type, uint64_t Flags,
+                   uint32_t Alignment)
+      : MergeSyntheticSection(Name, Type, Flags, Alignment) {}
+
+  void finalizeContents() override;
+};
+
+// A MergeSyntheticSection that only deduplicates identical pieces.
+// This is the default. The layout is the same as
+// StringTableBuilder::finalizeInOrder() would create.
+class MergeNoTailSection final : public MergeSyntheticSection {
+public:
+  MergeNoTailSection(StringRef Name, uint32_t Type, uint64_t Flags,
+                     uint32_t Alignment)
+      : MergeSyntheticSection(Name, Type, Flags, Alignment) {}
+
+  void finalizeContents() override;
 };
 
 // .MIPS.abiflags section.
@@ -759,6 +929,8 @@ struct InX {
   static BssSection *BssRelRo;
   static BuildIdSection *BuildId;
   static InputSection *Common;
+  static DebugNamesSection *DebugNames;
+  static DebugNamesStrSection *DebugNamesStr;
   static SyntheticSection *Dynamic;
   static StringTableSection *DynStrTab;
   static SymbolTableBaseSection *DynSymTab;
@@ -784,6 +956,7 @@ template <class ELFT> struct In : public InX {
   static RelocationSection<ELFT> *RelaDyn;
   static RelocationSection<ELFT> *RelaPlt;
   static RelocationSection<ELFT> *RelaIplt;
+  static RelrSection<ELFT> *RelrDyn;
   static VersionDefinitionSection<ELFT> *VerDef;
   static VersionTableSection<ELFT> *VerSym;
   static VersionNeedSection<ELFT> *VerNeed;
@@ -795,6 +968,7 @@ template <class ELFT> HashTableSection<ELFT> *In<ELFT>::HashTab;
 template <class ELFT> RelocationSection<ELFT> *In<ELFT>::RelaDyn;
 template <class ELFT> RelocationSection<ELFT> *In<ELFT>::RelaPlt;
 template <class ELFT> RelocationSection<ELFT> *In<ELFT>::RelaIplt;
+template <class ELFT> RelrSection<ELFT> *In<ELFT>::RelrDyn;
 template <class ELFT> VersionDefinitionSection<ELFT> *In<ELFT>::VerDef;
 template <class ELFT> VersionTableSection<ELFT> *In<ELFT>::VerSym;
 template <class ELFT> VersionNeedSection<ELFT> *In<ELFT>::VerNeed;
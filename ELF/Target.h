@@ -48,9 +48,13 @@ public:
   virtual bool usesOnlyLowPageBits(uint32_t Type) const;
 
   // Decide whether a Thunk is needed for the relocation from File
-  // targeting S.
+  // targeting S. BranchAddr is the address of the branch instruction.
   virtual bool needsThunk(RelExpr Expr, uint32_t RelocType,
-                          const InputFile *File, const SymbolBody &S) const;
+                          const InputFile *File, uint64_t BranchAddr,
+                          const SymbolBody &S) const;
+  // Return true if a branch at Src with relocation RelocType can reach Dst.
+  virtual bool inBranchRange(uint32_t RelocType, uint64_t Src,
+                             uint64_t Dst) const;
   virtual RelExpr getRelExpr(uint32_t Type, const SymbolBody &S,
                              const uint8_t *Loc) const = 0;
   virtual void relocateOne(uint8_t *Loc, uint32_t Type, uint64_t Val) const = 0;
@@ -89,6 +93,12 @@ public:
 
   bool NeedsThunks = false;
 
+  // If non-zero, range extension Thunks are placed in ThunkSections spaced
+  // ThunkSectionSpacing bytes apart in large executable OutputSections. It
+  // must be a little smaller than the branch range so that a branch can
+  // reach a ThunkSection from anywhere in between.
+  uint32_t ThunkSectionSpacing = 0;
+
   // A 4-byte field corresponding to one or more trap instructions, used to pad
   // executable OutputSections.
   uint32_t TrapInstr = 0;
@@ -60,6 +60,7 @@
 #define LLD_ELF_THREADS_H
 
 #include "Config.h"
+#include "Timer.h"
 
 #include "llvm/Support/Parallel.h"
 #include <functional>
@@ -69,6 +70,21 @@ namespace elf {
 
 template <class IterTy, class FuncTy>
 void parallelForEach(IterTy Begin, IterTy End, FuncTy Fn) {
+  // If --time-trace-file is given, we record which threads ran the loop.
+  if (!Config->TimeTraceFile.empty()) {
+    ParallelSpan Span;
+    auto TracedFn = [&](decltype(*Begin) X) {
+      Span.enter();
+      Fn(X);
+      Span.leave();
+    };
+    if (Config->Threads)
+      for_each(llvm::parallel::par, Begin, End, TracedFn);
+    else
+      for_each(llvm::parallel::seq, Begin, End, TracedFn);
+    return;
+  }
+
   if (Config->Threads)
     for_each(llvm::parallel::par, Begin, End, Fn);
   else
@@ -77,6 +93,20 @@ void parallelForEach(IterTy Begin, IterTy End, FuncTy Fn) {
 
 inline void parallelForEachN(size_t Begin, size_t End,
                              std::function<void(size_t)> Fn) {
+  if (!Config->TimeTraceFile.empty()) {
+    ParallelSpan Span;
+    auto TracedFn = [&](size_t I) {
+      Span.enter();
+      Fn(I);
+      Span.leave();
+    };
+    if (Config->Threads)
+      for_each_n(llvm::parallel::par, Begin, End, TracedFn);
+    else
+      for_each_n(llvm::parallel::seq, Begin, End, TracedFn);
+    return;
+  }
+
   if (Config->Threads)
     for_each_n(llvm::parallel::par, Begin, End, Fn);
   else
@@ -20,14 +20,14 @@ class ThunkSection;
 // A Thunk is a code-sequence inserted by the linker in between a caller and
 // the callee. The relocation to the callee is redirected to the Thunk, which
 // after executing transfers control to the callee. Typical uses of Thunks
-// include transferring control from non-pi to pi and changing state on
-// targets like ARM.
+// include transferring control from non-pi to pi, changing state on
+// targets like ARM and extending the range of a branch instruction.
 //
 // Thunks can be created for DefinedRegular, Shared and Undefined Symbols.
 // Thunks are assigned to synthetic ThunkSections
 class Thunk {
 public:
-  Thunk(const SymbolBody &Destination);
+  Thunk(SymbolBody &Destination);
   virtual ~Thunk();
 
   virtual uint32_t size() const { return 0; }
@@ -41,16 +41,22 @@ public:
   // a branch and fall through to the first Symbol in the Target.
   virtual InputSection *getTargetInputSection() const { return nullptr; }
 
+  // Return true if a branch with relocation Type can be redirected to this
+  // Thunk. A Thunk created for one caller may be reused by other callers that
+  // can reach it.
+  virtual bool isCompatibleWith(uint32_t Type) const { return true; }
+
   // The alignment requirement for this Thunk, defaults to the size of the
   // typical code section alignment.
-  const SymbolBody &Destination;
+  SymbolBody &Destination;
   SymbolBody *ThunkSym;
   uint64_t Offset;
   uint32_t alignment = 4;
 };
 
 // For a Relocation to symbol S create a Thunk to be added to a synthetic
-// ThunkSection. At present there are implementations for ARM and Mips Thunks.
+// ThunkSection. At present there are implementations for AArch64, ARM and
+// Mips Thunks.
 Thunk *addThunk(uint32_t RelocType, SymbolBody &S);
 
 } // namespace elf
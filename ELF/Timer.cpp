@@ -0,0 +1,204 @@
+//===- Timer.cpp ----------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Timer.h"
+#include "Config.h"
+#include "Error.h"
+
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+
+using namespace llvm;
+
+using namespace lld;
+using namespace lld::elf;
+
+typedef std::chrono::steady_clock Clock;
+
+namespace {
+struct TraceEvent {
+  StringRef Name;
+  unsigned Tid;
+  Clock::time_point Start;
+  Clock::time_point End;
+};
+} // namespace
+
+static Clock::time_point StartTime;
+static bool Reported;
+
+// The innermost running timer. Timers are started and stopped only by
+// the main thread.
+static Timer *Current;
+
+// Used to sort timers in the order they first ran.
+static uint64_t NextSeq;
+
+static std::mutex EventsMu;
+static std::vector<TraceEvent> Events;
+
+// Returns a small integer identifying the current thread.
+static unsigned getThreadIndex() {
+  static std::atomic<unsigned> NextIndex;
+  static LLVM_THREAD_LOCAL unsigned Index = 0;
+  if (Index == 0)
+    Index = ++NextIndex;
+  return Index - 1;
+}
+
+static void addEvent(StringRef Name, unsigned Tid, Clock::time_point Start,
+                     Clock::time_point End) {
+  std::lock_guard<std::mutex> Lock(EventsMu);
+  Events.push_back({Name, Tid, Start, End});
+}
+
+Timer::Timer(StringRef Name, Timer &Parent) : Name(Name) {
+  Parent.Children.push_back(this);
+}
+
+Timer &Timer::root() {
+  static Timer Root("Total link time");
+  return Root;
+}
+
+void Timer::addToTotal(std::chrono::nanoseconds D) { Total += D; }
+
+void Timer::reset() {
+  Total = std::chrono::nanoseconds(0);
+  Seq = 0;
+  for (Timer *Child : Children)
+    Child->reset();
+}
+
+void Timer::print(raw_ostream &OS, int Depth, double RootMillis) {
+  double Millis = Total.count() / 1e6;
+  std::string S = std::string(Depth * 2, ' ') + Name.str();
+  OS << format("%-44s %10.2f ms %5.1f%%\n", S.c_str(), Millis,
+               RootMillis ? Millis * 100 / RootMillis : 0.0);
+
+  std::vector<Timer *> V;
+  for (Timer *Child : Children)
+    if (Child->Seq)
+      V.push_back(Child);
+  std::sort(V.begin(), V.end(),
+            [](Timer *A, Timer *B) { return A->Seq < B->Seq; });
+  for (Timer *Child : V)
+    Child->print(OS, Depth + 1, RootMillis);
+}
+
+ScopedTimer::ScopedTimer(Timer &T) : T(&T), Parent(Current) {
+  if (!T.Seq)
+    T.Seq = ++NextSeq;
+  Current = &T;
+  Start = Clock::now();
+}
+
+void ScopedTimer::stop() {
+  if (!T)
+    return;
+  Clock::time_point End = Clock::now();
+  T->addToTotal(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(End - Start));
+  if (!Config->TimeTraceFile.empty())
+    addEvent(T->getName(), getThreadIndex(), Start, End);
+  Current = Parent;
+  T = nullptr;
+}
+
+ParallelSpan::ParallelSpan() : Name(Current ? Current->getName() : "") {
+  static std::atomic<uint64_t> NextId;
+  Id = ++NextId;
+}
+
+ParallelSpan::~ParallelSpan() {
+  for (std::unique_ptr<Slot> &S : Slots)
+    addEvent(Name, S->Tid, S->Start, S->End);
+}
+
+// Returns the current thread's slot, creating one if this is the first
+// iteration the thread runs for this loop.
+ParallelSpan::Slot *ParallelSpan::getSlot() {
+  static LLVM_THREAD_LOCAL uint64_t CurId = 0;
+  static LLVM_THREAD_LOCAL Slot *CurSlot = nullptr;
+  if (CurId == Id)
+    return CurSlot;
+
+  Clock::time_point Now = Clock::now();
+  std::lock_guard<std::mutex> Lock(Mu);
+  Slots.emplace_back(new Slot{getThreadIndex(), Now, Now});
+  CurId = Id;
+  CurSlot = Slots.back().get();
+  return CurSlot;
+}
+
+void ParallelSpan::leave() { getSlot()->End = Clock::now(); }
+
+void elf::startTimers() {
+  Timer::root().reset();
+  Events.clear();
+  Reported = false;
+  Current = &Timer::root();
+  NextSeq = 0;
+  Timer::root().Seq = ++NextSeq;
+  getThreadIndex();
+  StartTime = Clock::now();
+}
+
+static int64_t toMicros(Clock::duration D) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(D).count();
+}
+
+// Writes trace events in the Chrome trace event format. Event names are
+// string literals in the source code, so they don't need escaping.
+static void writeTraceFile() {
+  std::error_code EC;
+  raw_fd_ostream OS(Config->TimeTraceFile, EC, sys::fs::F_None);
+  if (EC) {
+    error("cannot open " + Config->TimeTraceFile + ": " + EC.message());
+    return;
+  }
+
+  OS << "{\"traceEvents\":[\n";
+  for (size_t I = 0, E = Events.size(); I != E; ++I) {
+    const TraceEvent &Ev = Events[I];
+    OS << "{\"name\":\"" << Ev.Name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+       << Ev.Tid << ",\"ts\":" << toMicros(Ev.Start - StartTime)
+       << ",\"dur\":" << toMicros(Ev.End - Ev.Start) << "}"
+       << (I + 1 == E ? "\n" : ",\n");
+  }
+  OS << "]}\n";
+}
+
+void elf::reportTimers() {
+  if (Reported)
+    return;
+  Reported = true;
+
+  Timer &Root = Timer::root();
+  Clock::time_point End = Clock::now();
+  Root.Total =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(End - StartTime);
+  Current = nullptr;
+
+  if (Config->Stats) {
+    std::string S;
+    raw_string_ostream OS(S);
+    Root.print(OS, 0, Root.Total.count() / 1e6);
+    message(StringRef(OS.str()).rtrim());
+  }
+
+  if (!Config->TimeTraceFile.empty()) {
+    addEvent(Root.getName(), getThreadIndex(), StartTime, End);
+    writeTraceFile();
+  }
+}
@@ -0,0 +1,116 @@
+//===- Timer.h --------------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines timers to measure the wall-clock time spent in each
+// phase of the linker. With --stats, the times are printed out as a
+// table at the end of a link. With --time-trace-file, they are written
+// to a file in the Chrome trace event format, which can be viewed with
+// chrome://tracing. The trace file also contains a span for each thread
+// that worked on a parallelForEach loop.
+//
+// Timers form a tree. Each phase defines a static Timer object whose
+// parent is Timer::root() or another timer, and measures a scope by
+// creating a ScopedTimer for it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_TIMER_H
+#define LLD_ELF_TIMER_H
+
+#include "lld/Core/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lld {
+namespace elf {
+
+class Timer {
+public:
+  Timer(llvm::StringRef Name, Timer &Parent);
+
+  // Returns the root timer, which measures the entire link.
+  static Timer &root();
+
+  void addToTotal(std::chrono::nanoseconds D);
+  llvm::StringRef getName() const { return Name; }
+
+private:
+  explicit Timer(llvm::StringRef Name) : Name(Name) {}
+  void reset();
+  void print(raw_ostream &OS, int Depth, double RootMillis);
+
+  friend class ScopedTimer;
+  friend void startTimers();
+  friend void reportTimers();
+
+  llvm::StringRef Name;
+  std::vector<Timer *> Children;
+
+  // Total is the sum of the time measured by this timer. Seq is used
+  // to print timers in the order they first ran; 0 means never.
+  std::chrono::nanoseconds Total{0};
+  uint64_t Seq = 0;
+};
+
+// Measures the time from construction to stop() or destruction and adds
+// it to a given timer.
+class ScopedTimer {
+public:
+  explicit ScopedTimer(Timer &T);
+  ~ScopedTimer() { stop(); }
+  void stop();
+
+private:
+  Timer *T;
+  Timer *Parent;
+  std::chrono::steady_clock::time_point Start;
+};
+
+// Records a trace event for each thread that ran at least one iteration
+// of a parallel loop. An event spans from the beginning of the first
+// iteration to the end of the last iteration the thread ran.
+class ParallelSpan {
+public:
+  ParallelSpan();
+  ~ParallelSpan();
+
+  // Called at the beginning and the end of each iteration.
+  void enter() { getSlot(); }
+  void leave();
+
+private:
+  struct Slot {
+    unsigned Tid;
+    std::chrono::steady_clock::time_point Start;
+    std::chrono::steady_clock::time_point End;
+  };
+
+  Slot *getSlot();
+
+  uint64_t Id;
+  llvm::StringRef Name;
+  std::mutex Mu;
+  std::vector<std::unique_ptr<Slot>> Slots;
+};
+
+// Resets all timers and starts the root timer.
+void startTimers();
+
+// Stops the root timer and reports the results as requested by --stats
+// and --time-trace-file. Calling this more than once is a no-op.
+void reportTimers();
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Writer.h"
+#include "CallGraphSort.h"
 #include "Config.h"
 #include "Filesystem.h"
 #include "LinkerScript.h"
@@ -20,9 +21,9 @@
 #include "SyntheticSections.h"
 #include "Target.h"
 #include "Threads.h"
+#include "Timer.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
-#include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <climits>
 
@@ -71,7 +72,7 @@ private:
   void writeSectionsBinary();
   void writeBuildId();
 
-  std::unique_ptr<FileOutputBuffer> Buffer;
+  std::unique_ptr<OutputBuffer> Buffer;
 
   OutputSectionFactory Factory{OutputSections};
 
@@ -121,6 +122,15 @@ template <class ELFT> static bool needsInterpSection() {
          !Config->DynamicLinker.empty() && !Script->ignoreInterpSection();
 }
 
+static Timer WriterTimer("Write output", Timer::root());
+static Timer FinalizeTimer("Finalize sections", WriterTimer);
+static Timer ScanRelocTimer("Scan relocations", FinalizeTimer);
+static Timer CompressTimer("Compress debug sections", WriterTimer);
+static Timer AssignAddressesTimer("Assign addresses", WriterTimer);
+static Timer WriteSectionsTimer("Write sections", WriterTimer);
+static Timer BuildIdTimer("Build ID", WriterTimer);
+static Timer MapFileTimer("Map file", WriterTimer);
+
 template <class ELFT> void elf::writeResult() { Writer<ELFT>().run(); }
 
 template <class ELFT> void Writer<ELFT>::removeEmptyPTLoad() {
@@ -164,6 +174,8 @@ template <class ELFT> void Writer<ELFT>::clearOutputSections() {
 
 // The main function of the writer.
 template <class ELFT> void Writer<ELFT>::run() {
+  ScopedTimer T(WriterTimer);
+
   // Create linker-synthesized sections such as .got or .plt.
   // Such sections are of type input section.
   createSyntheticSections();
@@ -192,6 +204,17 @@ template <class ELFT> void Writer<ELFT>::run() {
     Script->processCommands(Factory);
   }
 
+  // .debug_names can be built only after .debug_info sections are
+  // assigned to output sections, and it adds strings to .debug_str.
+  // Build it now and fix the sizes of the output sections that were
+  // computed while the two sections were still empty.
+  if (InX::DebugNames) {
+    InX::DebugNames->finalizeContents();
+    for (SyntheticSection *SS : {InX::DebugNames, InX::DebugNamesStr})
+      if (OutputSection *Sec = SS->getParent())
+        Sec->updateOffsets();
+  }
+
   if (Config->Discard != DiscardPolicy::All)
     copyLocalSymbols();
 
@@ -206,17 +229,19 @@ template <class ELFT> void Writer<ELFT>::run() {
   if (ErrorCount)
     return;
 
-  if (!Script->Opt.HasSections && !Config->Relocatable)
-    fixSectionAlignments();
-
   // If -compressed-debug-sections is specified, we need to compress
   // .debug_* sections. Do it right now because it changes the size of
-  // output sections.
-  parallelForEach(
-      OutputSectionCommands.begin(), OutputSectionCommands.end(),
-      [](OutputSectionCommand *Cmd) { Cmd->maybeCompress<ELFT>(); });
+  // output sections. Each section is compressed in parallel internally.
+  {
+    ScopedTimer T2(CompressTimer);
+    for (OutputSectionCommand *Cmd : OutputSectionCommands)
+      Cmd->maybeCompress<ELFT>();
+  }
 
-  Script->assignAddresses(Phdrs);
+  {
+    ScopedTimer T2(AssignAddressesTimer);
+    Script->assignAddresses(Phdrs);
+  }
 
   // Remove empty PT_LOAD to avoid causing the dynamic linker to try to mmap a
   // 0 sized region. This has to be done late since only after assignAddresses
@@ -260,18 +285,24 @@ template <class ELFT> void Writer<ELFT>::run() {
 
 
   // Handle -Map option.
-  writeMapFile<ELFT>(OutputSectionCommands);
+  {
+    ScopedTimer T2(MapFileTimer);
+    writeMapFile<ELFT>(OutputSectionCommands);
+  }
   if (ErrorCount)
     return;
 
   if (auto EC = Buffer->commit())
     error("failed to write to the output file: " + EC.message());
+  T.stop();
 
   // Flush the output streams and exit immediately. A full shutdown
   // is a good test that we are keeping track of all allocated memory,
   // but actually freeing it is a waste of time in a regular linker run.
-  if (Config->ExitEarly)
+  if (Config->ExitEarly) {
+    reportTimers();
     exitLld(0);
+  }
 }
 
 // Initialize Out members.
@@ -363,6 +394,11 @@ template <class ELFT> void Writer<ELFT>::createSyntheticSections() {
     Add(InX::Dynamic);
     Add(InX::DynStrTab);
     Add(In<ELFT>::RelaDyn);
+
+    if (Config->RelrPackDynRelocs) {
+      In<ELFT>::RelrDyn = make<RelrSection<ELFT>>();
+      Add(In<ELFT>::RelrDyn);
+    }
   }
 
   // Add .got. MIPS' .got is so different from the other archs,
@@ -385,6 +421,13 @@ template <class ELFT> void Writer<ELFT>::createSyntheticSections() {
     Add(InX::GdbIndex);
   }
 
+  if (Config->DebugNames) {
+    InX::DebugNames = make<DebugNamesSection>();
+    Add(InX::DebugNames);
+    InX::DebugNamesStr = make<DebugNamesStrSection>();
+    Add(InX::DebugNamesStr);
+  }
+
   // We always need to add rel[a].plt to output if it has entries.
   // Even for static linking it can contain R_[*]_IRELATIVE relocations.
   In<ELFT>::RelaPlt = make<RelocationSection<ELFT>>(
@@ -879,11 +922,15 @@ static void sortCtorsDtors(OutputSection *S) {
     reinterpret_cast<OutputSection *>(S)->sortCtorsDtors();
 }
 
-// Sort input sections using the list provided by --symbol-ordering-file.
+// Builds section priorities from --symbol-ordering-file or call graph
+// profiles. Sections with lower priorities are placed first. Sections
+// that are not mentioned have priority 0.
 template <class ELFT>
-static void sortBySymbolsOrder(ArrayRef<OutputSection *> OutputSections) {
+static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
+  if (!Config->CallGraphProfile.empty())
+    return computeCallGraphProfileOrder();
   if (Config->SymbolOrderingFile.empty())
-    return;
+    return {};
 
   // Build a map from symbols to their priorities. Symbols that didn't
   // appear in the symbol ordering file have the lowest priority 0.
@@ -894,21 +941,32 @@ static void sortBySymbolsOrder(ArrayRef<OutputSection *> OutputSections) {
     SymbolOrder.insert({S, Priority++});
 
   // Build a map from sections to their priorities.
-  DenseMap<SectionBase *, int> SectionOrder;
+  DenseMap<const InputSectionBase *, int> SectionOrder;
   for (elf::ObjectFile<ELFT> *File : Symtab<ELFT>::X->getObjectFiles()) {
     for (SymbolBody *Body : File->getSymbols()) {
       auto *D = dyn_cast<DefinedRegular>(Body);
       if (!D || !D->Section)
         continue;
-      int &Priority = SectionOrder[D->Section];
+      auto *Sec = dyn_cast<InputSectionBase>(D->Section);
+      if (!Sec)
+        continue;
+      int &Priority = SectionOrder[Sec];
       Priority = std::min(Priority, SymbolOrder.lookup(D->getName()));
     }
   }
+  return SectionOrder;
+}
 
-  // Sort sections by priority.
-  for (OutputSection *Base : OutputSections)
-    if (auto *Sec = dyn_cast<OutputSection>(Base))
-      Sec->sort([&](InputSectionBase *S) { return SectionOrder.lookup(S); });
+// Sort input sections by priorities computed by buildSectionOrder.
+template <class ELFT>
+static void sortBySectionOrder(ArrayRef<OutputSection *> OutputSections) {
+  DenseMap<const InputSectionBase *, int> SectionOrder =
+      buildSectionOrder<ELFT>();
+  if (SectionOrder.empty())
+    return;
+
+  for (OutputSection *Sec : OutputSections)
+    Sec->sort([&](InputSectionBase *S) { return SectionOrder.lookup(S); });
 }
 
 template <class ELFT>
@@ -938,7 +996,7 @@ template <class ELFT> void Writer<ELFT>::createSections() {
     if (IS)
       Factory.addInputSec(IS, getOutputSectionName(IS->Name));
 
-  sortBySymbolsOrder<ELFT>(OutputSections);
+  sortBySectionOrder<ELFT>(OutputSections);
   sortInitFini(findSection(".init_array"));
   sortInitFini(findSection(".fini_array"));
   sortCtorsDtors(findSection(".ctors"));
@@ -1158,6 +1216,8 @@ static void removeUnusedSyntheticSections(std::vector<OutputSection *> &V) {
 
 // Create output section objects and add them to OutputSections.
 template <class ELFT> void Writer<ELFT>::finalizeSections() {
+  ScopedTimer T(FinalizeTimer);
+
   Out::DebugInfo = findSection(".debug_info");
   Out::PreinitArray = findSection(".preinit_array");
   Out::InitArray = findSection(".init_array");
@@ -1190,7 +1250,12 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
 
   // Scan relocations. This must be done after every symbol is declared so that
   // we can correctly decide if a dynamic relocation is needed.
-  forEachRelSec(scanRelocations<ELFT>);
+  {
+    ScopedTimer T2(ScanRelocTimer);
+    std::vector<InputSectionBase *> RelSecs;
+    forEachRelSec([&](InputSectionBase &S) { RelSecs.push_back(&S); });
+    scanRelocations<ELFT>(RelSecs);
+  }
 
   if (InX::Plt && !InX::Plt->empty())
     InX::Plt->addSymbols();
@@ -1252,6 +1317,11 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
     Out::ProgramHeaders->Size = sizeof(Elf_Phdr) * Phdrs.size();
   }
 
+  // Do this before creating Thunks so that the addresses they see are the
+  // final ones.
+  if (!Script->Opt.HasSections && !Config->Relocatable)
+    fixSectionAlignments();
+
   // Compute the size of .rela.dyn and .rela.plt early since we need
   // them to populate .dynamic.
   for (SyntheticSection *SS : {In<ELFT>::RelaDyn, In<ELFT>::RelaPlt})
@@ -1263,30 +1333,39 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
   applySynthetic({InX::DynSymTab,    InX::Bss,           InX::BssRelRo,
                   InX::GnuHashTab,   In<ELFT>::HashTab,  InX::SymTab,
                   InX::ShStrTab,     InX::StrTab,        In<ELFT>::VerDef,
-                  InX::DynStrTab,    InX::GdbIndex,      InX::Got,
-                  InX::MipsGot,      InX::IgotPlt,       InX::GotPlt,
-                  In<ELFT>::RelaDyn, In<ELFT>::RelaIplt, In<ELFT>::RelaPlt,
-                  InX::Plt,          InX::Iplt,          In<ELFT>::EhFrameHdr,
-                  In<ELFT>::VerSym,  In<ELFT>::VerNeed,  InX::Dynamic},
+                  InX::DynStrTab,    InX::GdbIndex,      InX::DebugNames,
+                  InX::Got,          InX::MipsGot,       InX::IgotPlt,
+                  InX::GotPlt,       In<ELFT>::RelaDyn,  In<ELFT>::RelaIplt,
+                  In<ELFT>::RelaPlt, InX::Plt,           InX::Iplt,
+                  In<ELFT>::EhFrameHdr, In<ELFT>::VerSym, In<ELFT>::VerNeed,
+                  InX::Dynamic},
                  [](SyntheticSection *SS) { SS->finalizeContents(); });
 
   // Some architectures use small displacements for jump instructions.
   // It is linker's responsibility to create thunks containing long
   // jump instructions if jump targets are too far. Create thunks.
-  if (Target->NeedsThunks) {
-    // FIXME: only ARM Interworking and Mips LA25 Thunks are implemented,
-    // these
-    // do not require address information. To support range extension Thunks
-    // we need to assign addresses so that we can tell if jump instructions
-    // are out of range. This will need to turn into a loop that converges
-    // when no more Thunks are added
+  // Adding thunks moves code and may put other jumps out of range, so
+  // assign addresses and create thunks until no more thunks are added.
+  //
+  // The size of .relr.dyn depends on the addresses of the relocated
+  // locations, and it moves other sections when it grows, so it is
+  // computed in the same loop. .relr.dyn never shrinks, so it converges
+  // by itself, and iterations in which only .relr.dyn grew don't count
+  // towards the limit on thunk passes.
+  if (Target->NeedsThunks || In<ELFT>::RelrDyn) {
     ThunkCreator TC;
-    if (TC.createThunks(OutputSectionCommands)) {
-      applySynthetic({InX::MipsGot},
-                     [](SyntheticSection *SS) { SS->updateAllocSize(); });
-      if (TC.createThunks(OutputSectionCommands))
-        fatal("All non-range thunks should be created in first call");
-    }
+    bool Changed;
+    do {
+      Script->assignAddresses();
+      Changed = false;
+      if (Target->NeedsThunks)
+        Changed |= TC.createThunks(OutputSectionCommands);
+      if (In<ELFT>::RelrDyn)
+        Changed |= In<ELFT>::RelrDyn->updateAllocSize();
+      if (Changed)
+        applySynthetic({InX::MipsGot},
+                       [](SyntheticSection *SS) { SS->updateAllocSize(); });
+    } while (Changed);
   }
 
   // Fill other section headers. The dynamic table is finalized
@@ -1821,9 +1900,8 @@ template <class ELFT> void Writer<ELFT>::openFile() {
   }
 
   unlinkAsync(Config->OutputFile);
-  ErrorOr<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
-      FileOutputBuffer::create(Config->OutputFile, FileSize,
-                               FileOutputBuffer::F_executable);
+  ErrorOr<std::unique_ptr<OutputBuffer>> BufferOrErr =
+      createOutputBuffer(Config->OutputFile, FileSize);
 
   if (auto EC = BufferOrErr.getError())
     error("failed to open " + Config->OutputFile + ": " + EC.message());
@@ -1832,6 +1910,7 @@ template <class ELFT> void Writer<ELFT>::openFile() {
 }
 
 template <class ELFT> void Writer<ELFT>::writeSectionsBinary() {
+  ScopedTimer T(WriteSectionsTimer);
   uint8_t *Buf = Buffer->getBufferStart();
   for (OutputSectionCommand *Cmd : OutputSectionCommands) {
     OutputSection *Sec = Cmd->Sec;
@@ -1840,8 +1919,9 @@ template <class ELFT> void Writer<ELFT>::writeSectionsBinary() {
   }
 }
 
-// Write section contents to a mmap'ed file.
+// Write section contents to the output buffer.
 template <class ELFT> void Writer<ELFT>::writeSections() {
+  ScopedTimer T(WriteSectionsTimer);
   uint8_t *Buf = Buffer->getBufferStart();
 
   // PPC64 needs to process relocations in the .opd section
@@ -1884,6 +1964,7 @@ template <class ELFT> void Writer<ELFT>::writeSections() {
 template <class ELFT> void Writer<ELFT>::writeBuildId() {
   if (!InX::BuildId || !InX::BuildId->getParent())
     return;
+  ScopedTimer T(BuildIdTimer);
 
   // Compute a hash of all sections of the output file.
   uint8_t *Start = Buffer->getBufferStart();
@@ -0,0 +1,3 @@
+.section .foo,"ax",@progbits,unique,6
+A:
+ .byte 0x66
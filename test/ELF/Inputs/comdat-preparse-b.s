@@ -0,0 +1,5 @@
+.section .foo,"aG",@progbits,foo,comdat
+.byte 2
+
+.section .bar,"aG",@progbits,bar,comdat
+.byte 2
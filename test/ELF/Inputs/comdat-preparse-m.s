@@ -0,0 +1,6 @@
+.globl m
+m:
+  ret
+
+.section .bar,"aG",@progbits,bar,comdat
+.byte 3
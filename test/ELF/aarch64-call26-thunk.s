@@ -0,0 +1,22 @@
+// RUN: llvm-mc -filetype=obj -triple=aarch64-pc-freebsd %S/Inputs/abs.s -o %tabs
+// RUN: llvm-mc -filetype=obj -triple=aarch64-pc-freebsd %s -o %t
+// RUN: ld.lld %t %tabs -o %t2 2>&1
+// RUN: llvm-objdump -d -triple=aarch64-pc-freebsd %t2 | FileCheck %s
+// RUN: llvm-nm %t2 | FileCheck -check-prefix=SYM %s
+// REQUIRES: aarch64
+
+.text
+.globl _start
+_start:
+    bl big
+
+// The destination is out of range, so the branch goes through a thunk that
+// loads the address of big.
+// CHECK: Disassembly of section .text:
+// CHECK:         20000: {{.*}} bl #8
+// CHECK:         20008: 50 00 00 58 ldr x16, #8
+// CHECK-NEXT:    2000c: 00 02 1f d6 br x16
+// CHECK:         20010: 00 00 00 00
+// CHECK-NEXT:    20014: 10 00 00 00
+
+// SYM: 0000000000020008 t __AArch64AbsLongThunk_big
@@ -0,0 +1,42 @@
+// RUN: llvm-mc -filetype=obj -triple=armv7a-none-linux-gnueabi %s -o %t
+// RUN: llvm-mc -filetype=obj -triple=armv7a-none-linux-gnueabi %S/Inputs/far-arm-abs.s -o %tfar
+// RUN: ld.lld  %t %tfar -o %t2 2>&1
+// RUN: llvm-objdump -d -triple=armv7a-none-linux-gnueabi %t2 | FileCheck %s
+// RUN: llvm-nm %t2 | FileCheck -check-prefix=SYM %s
+// REQUIRES: arm
+ .syntax unified
+ .section .text, "ax",%progbits
+ .globl _start
+ .balign 0x10000
+ .type _start,%function
+_start:
+ // address of too_far symbols are just out of range of ARM branch with
+ // 26-bit immediate field and an addend of -8
+ bl  too_far1
+ b   too_far2
+ beq too_far3
+
+// The destinations are out of range, so each branch goes through a range
+// extension thunk placed after the caller that loads the address of the
+// destination.
+// CHECK: Disassembly of section .text:
+// CHECK-NEXT: _start:
+// CHECK-NEXT:    20000: {{.*}} bl #4
+// CHECK-NEXT:    20004: {{.*}} b #12
+// CHECK-NEXT:    20008: {{.*}} beq #20
+// CHECK: __ARMv7ABSLongThunk_too_far1:
+// CHECK-NEXT:    2000c: {{.*}} movw r12, #8
+// CHECK-NEXT:    20010: {{.*}} movt r12, #514
+// CHECK-NEXT:    20014: {{.*}} bx r12
+// CHECK: __ARMv7ABSLongThunk_too_far2:
+// CHECK-NEXT:    20018: {{.*}} movw r12, #12
+// CHECK-NEXT:    2001c: {{.*}} movt r12, #514
+// CHECK-NEXT:    20020: {{.*}} bx r12
+// CHECK: __ARMv7ABSLongThunk_too_far3:
+// CHECK-NEXT:    20024: {{.*}} movw r12, #16
+// CHECK-NEXT:    20028: {{.*}} movt r12, #514
+// CHECK-NEXT:    2002c: {{.*}} bx r12
+
+// SYM: 0002000c t __ARMv7ABSLongThunk_too_far1
+// SYM: 00020018 t __ARMv7ABSLongThunk_too_far2
+// SYM: 00020024 t __ARMv7ABSLongThunk_too_far3
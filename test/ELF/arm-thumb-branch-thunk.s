@@ -0,0 +1,42 @@
+// RUN: llvm-mc -filetype=obj -triple=thumbv7a-none-linux-gnueabi %s -o %t
+// RUN: llvm-mc -filetype=obj -triple=thumbv7a-none-linux-gnueabi %S/Inputs/far-arm-thumb-abs.s -o %tfar
+// RUN: ld.lld  %t %tfar -o %t2 2>&1
+// RUN: llvm-objdump -d -triple=thumbv7a-none-linux-gnueabi %t2 | FileCheck %s
+// RUN: llvm-nm %t2 | FileCheck -check-prefix=SYM %s
+// REQUIRES: arm
+ .syntax unified
+ .section .text, "ax",%progbits
+ .globl _start
+ .balign 0x10000
+ .type _start,%function
+_start:
+ // address of too_far symbols are just out of range of Thumb branches
+ // with 24-bit and 20-bit immediate fields and an addend of -4
+ bl  too_far1
+ b   too_far2
+ beq.w too_far3
+
+// The destinations are out of range, so each branch goes through a range
+// extension thunk placed after the caller that loads the address of the
+// destination.
+// CHECK: Disassembly of section .text:
+// CHECK-NEXT: _start:
+// CHECK-NEXT:    20000: {{.*}} bl #8
+// CHECK-NEXT:    20004: {{.*}} b.w #14
+// CHECK-NEXT:    20008: {{.*}} beq.w #20
+// CHECK: __Thumbv7ABSLongThunk_too_far1:
+// CHECK-NEXT:    2000c: {{.*}} movw r12, #5
+// CHECK-NEXT:    20010: {{.*}} movt r12, #258
+// CHECK-NEXT:    20014: {{.*}} bx r12
+// CHECK: __Thumbv7ABSLongThunk_too_far2:
+// CHECK-NEXT:    20016: {{.*}} movw r12, #9
+// CHECK-NEXT:    2001a: {{.*}} movt r12, #258
+// CHECK-NEXT:    2001e: {{.*}} bx r12
+// CHECK: __Thumbv7ABSLongThunk_too_far3:
+// CHECK-NEXT:    20020: {{.*}} movw r12, #13
+// CHECK-NEXT:    20024: {{.*}} movt r12, #18
+// CHECK-NEXT:    20028: {{.*}} bx r12
+
+// SYM: 0002000d t __Thumbv7ABSLongThunk_too_far1
+// SYM: 00020017 t __Thumbv7ABSLongThunk_too_far2
+// SYM: 00020021 t __Thumbv7ABSLongThunk_too_far3
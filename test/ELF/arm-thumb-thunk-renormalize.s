@@ -0,0 +1,66 @@
+// REQUIRES: arm
+// RUN: llvm-mc -filetype=obj -triple=thumbv7a-none-linux-gnueabi %s -o %t
+// RUN: echo "SECTIONS { \
+// RUN:       .text 0x100000 : { *(.text .text.1 .text.2) } \
+// RUN:       .far 0x2000000 : { *(.far) } \
+// RUN:       } " > %t.script
+// RUN: ld.lld --script %t.script %t -o %t2 2>&1
+// RUN: llvm-objdump -d -triple=thumbv7a-none-linux-gnueabi %t2 | FileCheck %s
+// RUN: llvm-nm %t2 | FileCheck -check-prefix=SYM %s
+
+// A thunk that is in range when it is created can be pushed out of range
+// by thunks added in the same pass. The caller must then be given a new
+// thunk in a later pass.
+//
+// In the first pass the caller in .text.1 is given a thunk in the
+// ThunkSection at the end of .text, 0x100000 bytes away. The caller in
+// .text.2 can't reach past that thunk, so a new ThunkSection is created
+// for it, which ends up between the first caller and its thunk. In the
+// second pass the first caller is out of range of its thunk and is given
+// a new one right after it.
+ .syntax unified
+ .section .text.1, "ax", %progbits
+ .balign 4
+ .globl _start
+ .type _start, %function
+_start:
+ beq.w farA
+
+ .section .text.2, "ax", %progbits
+ .balign 4
+ beq.w farB
+ .space 0xffff8
+
+ .section .far, "ax", %progbits
+ .balign 4
+ .globl farA
+ .type farA, %function
+farA:
+ bx lr
+ .balign 4
+ .globl farB
+ .type farB, %function
+farB:
+ bx lr
+
+// CHECK: Disassembly of section .text:
+// CHECK-NEXT: _start:
+// CHECK-NEXT:   100000: {{.*}} beq.w #0
+// CHECK: __Thumbv7ABSLongThunk_farA:
+// CHECK-NEXT:   100004: {{.*}} movw r12, #1
+// CHECK-NEXT:   100008: {{.*}} movt r12, #512
+// CHECK-NEXT:   10000c: {{.*}} bx r12
+// CHECK:        100010: {{.*}} beq.w #1048568
+// CHECK: __Thumbv7ABSLongThunk_farB:
+// CHECK-NEXT:   20000c: {{.*}} movw r12, #5
+// CHECK-NEXT:   200010: {{.*}} movt r12, #512
+// CHECK-NEXT:   200014: {{.*}} bx r12
+// The thunk created in the first pass is no longer used.
+// CHECK: __Thumbv7ABSLongThunk_farA:
+// CHECK-NEXT:   200018: {{.*}} movw r12, #1
+// CHECK-NEXT:   20001c: {{.*}} movt r12, #512
+// CHECK-NEXT:   200020: {{.*}} bx r12
+
+// SYM-DAG: 00100005 t __Thumbv7ABSLongThunk_farA
+// SYM-DAG: 00200019 t __Thumbv7ABSLongThunk_farA
+// SYM-DAG: 0020000d t __Thumbv7ABSLongThunk_farB
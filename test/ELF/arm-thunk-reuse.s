@@ -0,0 +1,43 @@
+// REQUIRES: arm
+// RUN: llvm-mc -filetype=obj -triple=armv7a-none-linux-gnueabi %s -o %t
+// RUN: echo "SECTIONS { \
+// RUN:       .text_low 0x100000 : { *(.text_low) } \
+// RUN:       .text_high 0x4000000 : { *(.text_high) } \
+// RUN:       .text : { *(.text) } \
+// RUN:       } " > %t.script
+// RUN: ld.lld --script %t.script %t -o %t2 2>&1
+// RUN: llvm-objdump -d -triple=armv7a-none-linux-gnueabi %t2 | FileCheck %s
+// RUN: llvm-nm %t2 | FileCheck -check-prefix=SYM %s
+
+// Callers that can reach an existing range extension thunk share it, even
+// if their relocation types differ.
+ .syntax unified
+ .section .text_low, "ax", %progbits
+ .globl _start
+ .type _start, %function
+_start:
+ bl far
+ bl far
+ b far
+ bx lr
+
+ .section .text_high, "ax", %progbits
+ .globl far
+ .type far, %function
+far:
+ bx lr
+
+// CHECK: Disassembly of section .text_low:
+// CHECK-NEXT: _start:
+// CHECK-NEXT:   100000: {{.*}} bl #8
+// CHECK-NEXT:   100004: {{.*}} bl #4
+// CHECK-NEXT:   100008: {{.*}} b #0
+// CHECK-NEXT:   10000c: {{.*}} bx lr
+// CHECK: __ARMv7ABSLongThunk_far:
+// CHECK-NEXT:   100010: {{.*}} movw r12, #0
+// CHECK-NEXT:   100014: {{.*}} movt r12, #1024
+// CHECK-NEXT:   100018: {{.*}} bx r12
+// CHECK-NOT: LongThunk
+
+// SYM: 00100010 t __ARMv7ABSLongThunk_far
+// SYM-NOT: LongThunk
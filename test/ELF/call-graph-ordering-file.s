@@ -0,0 +1,58 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t.out
+# RUN: llvm-objdump -s %t.out | FileCheck %s --check-prefix=BEFORE
+
+# BEFORE:      Contents of section .foo:
+# BEFORE-NEXT:  201000 44332211 55
+
+## A calls B, B calls C and C calls D, so they form a single cluster.
+## E is not in the call graph and comes last.
+# RUN: echo "A B 100" > %t.call_graph
+# RUN: echo "B C 100" >> %t.call_graph
+# RUN: echo "C D 100" >> %t.call_graph
+# RUN: echo "C nosuchsym 100" >> %t.call_graph
+# RUN: ld.lld --call-graph-ordering-file %t.call_graph %t.o -o %t2.out
+# RUN: llvm-objdump -s %t2.out | FileCheck %s --check-prefix=AFTER
+
+# AFTER:      Contents of section .foo:
+# AFTER-NEXT:  201000 11223344 55
+
+## A is also a local symbol in another file, so edges that refer to it
+## are ignored.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux \
+# RUN:   %p/Inputs/call-graph-ordering-file.s -o %t2.o
+# RUN: ld.lld --call-graph-ordering-file %t.call_graph %t.o %t2.o \
+# RUN:   -o %t2.out 2>&1 | FileCheck %s --check-prefix=AMBIGUOUS
+# AMBIGUOUS: warning: {{.*}}.call_graph: ambiguous symbol name: A
+
+# RUN: echo "A B" > %t.bad
+# RUN: not ld.lld --call-graph-ordering-file %t.bad %t.o -o %t3.out 2>&1 \
+# RUN:   | FileCheck %s --check-prefix=PARSE
+# PARSE: parse error: A B
+
+# RUN: echo "A" > %t.order
+# RUN: not ld.lld --call-graph-ordering-file %t.call_graph \
+# RUN:   --symbol-ordering-file %t.order %t.o -o %t3.out 2>&1 \
+# RUN:   | FileCheck %s --check-prefix=BOTH
+# BOTH: --symbol-ordering-file and --call-graph-ordering-file may not be used together
+
+.section .foo,"ax",@progbits,unique,1
+D:
+ .byte 0x44
+
+.section .foo,"ax",@progbits,unique,2
+C:
+ .byte 0x33
+
+.section .foo,"ax",@progbits,unique,3
+B:
+ .byte 0x22
+
+.section .foo,"ax",@progbits,unique,4
+A:
+ .byte 0x11
+
+.section .foo,"ax",@progbits,unique,5
+E:
+ .byte 0x55
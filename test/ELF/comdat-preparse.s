@@ -0,0 +1,30 @@
+// REQUIRES: x86
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux \
+// RUN:   %p/Inputs/comdat-preparse-b.s -o %tb.o
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux \
+// RUN:   %p/Inputs/comdat-preparse-m.s -o %tm.o
+// RUN: rm -f %t.a
+// RUN: llvm-ar rcs %t.a %tm.o
+// RUN: ld.lld --threads -shared %t.o %t.a %tb.o -o %t.so
+// RUN: llvm-objdump -s %t.so | FileCheck %s
+
+// Files on the command line are pre-parsed in parallel, and members of
+// groups that an earlier file also defines are not created at all.
+// The first definition of a group must still win, including when it is
+// in an archive member fetched before the rest of the command line.
+
+// foo is defined by %t.o and %tb.o. %t.o's one wins.
+// CHECK:      Contents of section .foo:
+// CHECK-NEXT: 01
+
+// bar is defined by %tb.o and by the archive member, which is fetched
+// for m before %tb.o is added. The archive member's one wins.
+// CHECK:      Contents of section .bar:
+// CHECK-NEXT: 03
+
+.section .foo,"aG",@progbits,foo,comdat
+.byte 1
+
+.text
+call m@plt
@@ -0,0 +1,19 @@
+# REQUIRES: x86, zlib
+
+## .debug_str is a single merged section larger than a compression
+## shard, so it is split across shards.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t --compress-debug-sections=zlib
+# RUN: llvm-dwarfdump %t -debug-dump=str | FileCheck %s
+
+# CHECK:      .debug_str contents:
+# CHECK-NEXT: 0x00000000: "AAAAAAAA
+# CHECK-NEXT: 0x00180001: "BBBB"
+# CHECK-NEXT: 0x00180006: "CCCC"
+
+.section .debug_str,"MS",@progbits,1
+.fill 0x180000, 1, 0x41
+.byte 0
+.asciz "BBBB"
+.asciz "CCCC"
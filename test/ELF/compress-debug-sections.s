@@ -25,6 +25,21 @@
 # RUN:   FileCheck -check-prefix=ERR %s
 # ERR: unknown --compress-debug-sections value: zlib-gabi
 
+## Check that all compression levels produce valid zlib streams.
+# RUN: ld.lld %t.o -o %t2 --compress-debug-sections=zlib \
+# RUN:   --compress-debug-sections-level=0
+# RUN: llvm-dwarfdump %t2 -debug-dump=str | \
+# RUN:   FileCheck %s --check-prefix=DEBUGSTR
+# RUN: ld.lld %t.o -o %t3 --compress-debug-sections=zlib \
+# RUN:   --compress-debug-sections-level=9
+# RUN: llvm-dwarfdump %t3 -debug-dump=str | \
+# RUN:   FileCheck %s --check-prefix=DEBUGSTR
+
+# RUN: not ld.lld %t.o -o %t1 --compress-debug-sections=zlib \
+# RUN:   --compress-debug-sections-level=10 2>&1 | \
+# RUN:   FileCheck -check-prefix=LEVEL %s
+# LEVEL: --compress-debug-sections-level: level must be between 0 and 9
+
 .section .debug_str,"MS",@progbits,1
 .Linfo_string0:
   .asciz "AAAAAAAAAAAAAAAAAAAAAAAAAAA"
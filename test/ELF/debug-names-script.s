@@ -0,0 +1,82 @@
+# REQUIRES: x86, zlib
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## .debug_str is placed before .debug_names and .debug_info, so it is
+## added to its output section before the strings that .debug_names
+## appends to it are known.
+
+# RUN: echo "SECTIONS { .text : { *(.text) } \
+# RUN:   .debug_str 0 : { *(.debug_str) } \
+# RUN:   .debug_names 0 : { *(.debug_names) } \
+# RUN:   .debug_info 0 : { *(.debug_info) } }" > %t.script
+# RUN: ld.lld --debug-names --compress-debug-sections=zlib -e 0 \
+# RUN:   -T %t.script %t.o -o %t
+# RUN: llvm-dwarfdump %t -debug-dump=str | FileCheck %s
+
+# CHECK:      .debug_str contents:
+# CHECK-NEXT: "foo"
+# CHECK-NEXT: "int"
+
+.section .debug_str,"MS",@progbits,1
+.Linfo_string0:
+ .asciz "foo"
+
+.section .debug_abbrev,"",@progbits
+ .byte 1                       # Abbreviation Code
+ .byte 17                      # DW_TAG_compile_unit
+ .byte 1                       # DW_CHILDREN_yes
+ .byte 0                       # EOM(1)
+ .byte 0                       # EOM(2)
+ .byte 2                       # Abbreviation Code
+ .byte 46                      # DW_TAG_subprogram
+ .byte 0                       # DW_CHILDREN_no
+ .byte 3                       # DW_AT_name
+ .byte 14                      # DW_FORM_strp
+ .byte 0                       # EOM(1)
+ .byte 0                       # EOM(2)
+ .byte 3                       # Abbreviation Code
+ .byte 36                      # DW_TAG_base_type
+ .byte 0                       # DW_CHILDREN_no
+ .byte 3                       # DW_AT_name
+ .byte 8                       # DW_FORM_string
+ .byte 0                       # EOM(1)
+ .byte 0                       # EOM(2)
+ .byte 0                       # EOM(3)
+
+.section .debug_info,"",@progbits
+.Lcu_begin0:
+ .long .Lcu_end0-.Lcu_begin0-4 # Length of Unit
+ .short 4                      # DWARF version number
+ .long .debug_abbrev           # Offset Into Abbrev. Section
+ .byte 8                       # Address Size (in bytes)
+ .byte 1                       # Abbrev [1] 0xb DW_TAG_compile_unit
+ .byte 2                       # Abbrev [2] 0xc DW_TAG_subprogram
+ .long .Linfo_string0          # DW_AT_name
+ .byte 3                       # Abbrev [3] 0x11 DW_TAG_base_type
+ .asciz "int"                  # DW_AT_name
+ .byte 0                       # End Of Children Mark
+.Lcu_end0:
+
+.section .debug_gnu_pubnames,"",@progbits
+ .long .LpubNames_end0-.LpubNames_begin0 # Length of Public Names Info
+.LpubNames_begin0:
+ .short 2                      # DWARF Version
+ .long .Lcu_begin0             # Offset of Compilation Unit Info
+ .long .Lcu_end0-.Lcu_begin0   # Compilation Unit Length
+ .long 12                      # DIE offset
+ .byte 48                      # Kind: FUNCTION, EXTERNAL
+ .asciz "foo"                  # External Name
+ .long 0                       # End Mark
+.LpubNames_end0:
+
+.section .debug_gnu_pubtypes,"",@progbits
+ .long .LpubTypes_end0-.LpubTypes_begin0 # Length of Public Types Info
+.LpubTypes_begin0:
+ .short 2                      # DWARF Version
+ .long .Lcu_begin0             # Offset of Compilation Unit Info
+ .long .Lcu_end0-.Lcu_begin0   # Compilation Unit Length
+ .long 17                      # DIE offset
+ .byte 144                     # Kind: TYPE, STATIC
+ .asciz "int"                  # External Name
+ .long 0                       # End Mark
+.LpubTypes_end0:
@@ -0,0 +1,91 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld --debug-names -e 0 %t.o -o %t
+# RUN: llvm-objdump -s -section=.debug_names -section=.debug_str %t \
+# RUN:   | FileCheck %s
+
+## "foo" is in .debug_str, so .debug_names refers to it. "int" is not,
+## so it is appended to .debug_str.
+
+# CHECK:      Contents of section .debug_str:
+# CHECK-NEXT:  0000 666f6f00 696e7400
+
+## Header: version 5, 1 CU, 2 buckets, 2 names, 17 bytes of abbreviations.
+## Names are "int" (DW_TAG_base_type at 0x11) and "foo" (DW_TAG_subprogram
+## at 0xc).
+# CHECK:      Contents of section .debug_names:
+# CHECK-NEXT:  0000 69000000 05000000 01000000 00000000
+# CHECK-NEXT:  0010 00000000 02000000 02000000 11000000
+# CHECK-NEXT:  0020 00000000 00000000 01000000 02000000
+# CHECK-NEXT:  0030 3080880b 8973880b 04000000 00000000
+# CHECK-NEXT:  0040 00000000 0a000000 01240106 03130000
+# CHECK-NEXT:  0050 022e0106 03130000 00010000 00001100
+# CHECK-NEXT:  0060 00000002 00000000 0c000000 00
+
+# RUN: not ld.lld --debug-names -r %t.o -o %t2 2>&1 \
+# RUN:   | FileCheck -check-prefix=ERR %s
+# ERR: -r and --debug-names may not be used together
+
+.section .debug_str,"MS",@progbits,1
+.Linfo_string0:
+ .asciz "foo"
+
+.section .debug_abbrev,"",@progbits
+ .byte 1                       # Abbreviation Code
+ .byte 17                      # DW_TAG_compile_unit
+ .byte 1                       # DW_CHILDREN_yes
+ .byte 0                       # EOM(1)
+ .byte 0                       # EOM(2)
+ .byte 2                       # Abbreviation Code
+ .byte 46                      # DW_TAG_subprogram
+ .byte 0                       # DW_CHILDREN_no
+ .byte 3                       # DW_AT_name
+ .byte 14                      # DW_FORM_strp
+ .byte 0                       # EOM(1)
+ .byte 0                       # EOM(2)
+ .byte 3                       # Abbreviation Code
+ .byte 36                      # DW_TAG_base_type
+ .byte 0                       # DW_CHILDREN_no
+ .byte 3                       # DW_AT_name
+ .byte 8                       # DW_FORM_string
+ .byte 0                       # EOM(1)
+ .byte 0                       # EOM(2)
+ .byte 0                       # EOM(3)
+
+.section .debug_info,"",@progbits
+.Lcu_begin0:
+ .long .Lcu_end0-.Lcu_begin0-4 # Length of Unit
+ .short 4                      # DWARF version number
+ .long .debug_abbrev           # Offset Into Abbrev. Section
+ .byte 8                       # Address Size (in bytes)
+ .byte 1                       # Abbrev [1] 0xb DW_TAG_compile_unit
+ .byte 2                       # Abbrev [2] 0xc DW_TAG_subprogram
+ .long .Linfo_string0          # DW_AT_name
+ .byte 3                       # Abbrev [3] 0x11 DW_TAG_base_type
+ .asciz "int"                  # DW_AT_name
+ .byte 0                       # End Of Children Mark
+.Lcu_end0:
+
+.section .debug_gnu_pubnames,"",@progbits
+ .long .LpubNames_end0-.LpubNames_begin0 # Length of Public Names Info
+.LpubNames_begin0:
+ .short 2                      # DWARF Version
+ .long .Lcu_begin0             # Offset of Compilation Unit Info
+ .long .Lcu_end0-.Lcu_begin0   # Compilation Unit Length
+ .long 12                      # DIE offset
+ .byte 48                      # Kind: FUNCTION, EXTERNAL
+ .asciz "foo"                  # External Name
+ .long 0                       # End Mark
+.LpubNames_end0:
+
+.section .debug_gnu_pubtypes,"",@progbits
+ .long .LpubTypes_end0-.LpubTypes_begin0 # Length of Public Types Info
+.LpubTypes_begin0:
+ .short 2                      # DWARF Version
+ .long .Lcu_begin0             # Offset of Compilation Unit Info
+ .long .Lcu_end0-.Lcu_begin0   # Compilation Unit Length
+ .long 17                      # DIE offset
+ .byte 144                     # Kind: TYPE, STATIC
+ .asciz "int"                  # External Name
+ .long 0                       # End Mark
+.LpubTypes_end0:
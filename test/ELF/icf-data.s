@@ -0,0 +1,70 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t
+# RUN: ld.lld %t -o %t2 --icf=all --verbose | FileCheck -check-prefix=CODE %s
+# RUN: ld.lld %t -o %t2 --icf-data=all --verbose | FileCheck -check-prefix=ALL %s
+# RUN: ld.lld %t -o %t2 --icf-data=safe --verbose | FileCheck -check-prefix=SAFE %s
+
+## Read-only data is not folded by default.
+# CODE-NOT: selected .rodata
+
+## Named and anonymous data are folded with --icf-data=all.
+# ALL-DAG: selected .rodata.a1
+# ALL-DAG:   removed .rodata.a2
+# ALL-DAG: selected .rodata.n1
+# ALL-DAG:   removed .rodata.n2
+# ALL-NOT: .data.w
+
+## Only anonymous data is folded with --icf-data=safe.
+# SAFE:     selected .rodata.a1
+# SAFE-NEXT:  removed .rodata.a2
+# SAFE-NOT: .rodata.n
+
+## Merged SHF_MERGE sections of the same size are not folded.
+# RUN: ld.lld %t -o %t2 --icf-data=all
+# RUN: llvm-objdump -s %t2 | FileCheck -check-prefix=MERGE %s
+# MERGE:      Contents of section .mrg8:
+# MERGE-NEXT: 11111111 11111111
+# MERGE:      Contents of section .mrg4:
+# MERGE-NEXT: 22222222 33333333
+
+# RUN: not ld.lld %t -o %t2 --icf-data=foo 2>&1 | FileCheck -check-prefix=ERR %s
+# ERR: unknown --icf-data mode: foo
+
+.globl _start
+_start:
+  movq .rodata.a1, %rax
+  movq .rodata.a2, %rax
+  movq n1, %rax
+  movq n2, %rax
+  movq w1, %rax
+  movq w2, %rax
+
+.section .rodata.a1, "a"
+  .quad 42
+
+.section .rodata.a2, "a"
+  .quad 42
+
+.section .rodata.n1, "a"
+n1:
+  .quad 43
+
+.section .rodata.n2, "a"
+n2:
+  .quad 43
+
+.section .data.w1, "aw"
+w1:
+  .quad 44
+
+.section .data.w2, "aw"
+w2:
+  .quad 44
+
+.section .mrg8, "aM", @progbits, 8
+  .quad 0x1111111111111111
+
+.section .mrg4, "aM", @progbits, 4
+  .long 0x22222222
+  .long 0x33333333
@@ -0,0 +1,23 @@
+// REQUIRES: x86
+// RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+// RUN: ld.lld %t.o -o %t.so -shared
+// RUN: llvm-objdump -s -section=.str16 -section=.str32 %t.so | FileCheck %s
+
+// Test that UTF-16 and UTF-32 strings are split at null characters and
+// not at zero bytes that are part of non-null characters.
+
+// CHECK:      Contents of section .str16:
+// CHECK-NEXT:  {{[0-9a-f]+}} 61000001 62006300 64006500 66000000
+// CHECK-NEXT:  {{[0-9a-f]+}} 61000000
+// CHECK:      Contents of section .str32:
+// CHECK-NEXT:  {{[0-9a-f]+}} 61000000 00000100 62000000 00000000
+// CHECK-NOT:  {{[0-9a-f]+}} 61000000
+
+.section .str16,"aMS",@progbits,2
+.short 0x61, 0x100, 0x62, 0x63, 0x64, 0x65, 0x66, 0
+.short 0x61, 0x100, 0x62, 0x63, 0x64, 0x65, 0x66, 0
+.short 0x61, 0
+
+.section .str32,"aMS",@progbits,4
+.long 0x61, 0x10000, 0x62, 0
+.long 0x61, 0x10000, 0x62, 0
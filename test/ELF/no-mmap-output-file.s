@@ -0,0 +1,19 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## --no-mmap-output-file writes the same bytes, including the build ID.
+# RUN: ld.lld --build-id=sha1 %t.o -o %t1
+# RUN: ld.lld --build-id=sha1 --no-mmap-output-file %t.o -o %t2
+# RUN: ld.lld --build-id=sha1 --no-mmap-output-file -no-threads %t.o -o %t3
+# RUN: cmp %t1 %t2
+# RUN: cmp %t1 %t3
+# RUN: llvm-readobj -file-headers %t2 | FileCheck %s
+
+# CHECK: Type: Executable
+
+.globl _start
+_start:
+  nop
+
+.data
+.quad 0x1122334455667788
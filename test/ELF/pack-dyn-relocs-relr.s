@@ -0,0 +1,71 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld -pie --pack-dyn-relocs=relr -Tdata=0x10000 %t.o -o %t
+# RUN: llvm-readobj -s -r -dynamic-table %t | FileCheck %s
+# RUN: llvm-objdump -s -section=.relr.dyn %t | FileCheck --check-prefix=RELR %s
+# RUN: llvm-objdump -s -section=.data %t | FileCheck --check-prefix=DATA %s
+# RUN: llvm-objdump -s -section=.got %t | FileCheck --check-prefix=GOT %s
+
+## The word-aligned relocations are packed into .relr.dyn: an address
+## for the GOT entry of bar, an address and a bitmap for the first three
+## relocations in .data, and another address for the last one, which is
+## too far away. The relocation at an odd address stays in .rela.dyn.
+
+# CHECK:      Name: .relr.dyn
+# CHECK-NEXT: Type: {{.*}}0x13
+# CHECK-NEXT: Flags [
+# CHECK-NEXT:   SHF_ALLOC
+# CHECK-NEXT: ]
+# CHECK-NEXT: Address: [[RELR:.*]]
+# CHECK-NEXT: Offset:
+# CHECK-NEXT: Size: 32
+# CHECK-NEXT: Link: 0
+# CHECK-NEXT: Info: 0
+# CHECK-NEXT: AddressAlignment: 8
+# CHECK-NEXT: EntrySize: 8
+
+# CHECK:      Relocations [
+# CHECK-NEXT:   Section ({{.*}}) .rela.dyn {
+# CHECK-NEXT:     0x10019 R_X86_64_RELATIVE - 0x10003
+# CHECK-NEXT:   }
+# CHECK-NEXT: ]
+
+# CHECK:      DynamicSection [
+# CHECK-DAG:    0x0000000000000024 {{.*}} [[RELR]]
+# CHECK-DAG:    0x0000000000000023 {{.*}} 0x20
+# CHECK-DAG:    0x0000000000000025 {{.*}} 0x8
+# CHECK:      ]
+
+# RELR:      Contents of section .relr.dyn:
+# RELR-NEXT: {{[0-9a-f]+}} {{[0-9a-f]+}} {{[0-9a-f]+}} 00000100 00000000
+# RELR-NEXT: {{[0-9a-f]+}} 07000000 00000000 28040100 00000000
+
+## Packed locations hold the link-time address plus the addend because
+## .relr.dyn has no addends. The location relocated by .rela.dyn does not.
+# DATA:      Contents of section .data:
+# DATA-NEXT: 10000 00000100 00000000 01000100 00000000
+# DATA-NEXT: 10010 02000100 00000000 00000000 00000000
+# DATA:      10420 00000000 00000000 04000100 00000000
+
+# GOT:      Contents of section .got:
+# GOT-NEXT: {{[0-9a-f]+}} 28040100 00000000
+
+# RUN: not ld.lld -pie --pack-dyn-relocs=foo %t.o -o %t2 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR %s
+# ERR: unknown -pack-dyn-relocs format: foo
+
+.text
+.long bar@GOTPCREL
+
+.data
+.align 8
+foo:
+.quad foo
+.quad foo + 1
+.quad foo + 2
+.byte 0
+.quad foo + 3
+.align 8
+.space 1024
+bar:
+.quad foo + 4
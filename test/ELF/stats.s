@@ -0,0 +1,34 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+# RUN: ld.lld --stats --gc-sections %t.o -o %t | FileCheck %s
+# CHECK:      Total link time
+# CHECK-NEXT:   Load input files
+# CHECK-NEXT:   Symbol resolution
+# CHECK-NEXT:   Mark live
+# CHECK-NEXT:   Merge sections
+# CHECK-NEXT:   Write output
+# CHECK-NEXT:     Finalize sections
+# CHECK-NEXT:       Scan relocations
+# CHECK-NEXT:     Compress debug sections
+# CHECK-NEXT:     Assign addresses
+# CHECK-NEXT:     Write sections
+
+# RUN: ld.lld --time-trace-file=%t.json %t.o -o %t
+# RUN: FileCheck --check-prefix=TRACE %s < %t.json
+# TRACE: {"traceEvents":[
+# TRACE-DAG: {"name":"Scan relocations","ph":"X","pid":1,"tid":0,
+# TRACE-DAG: {"name":"Total link time","ph":"X","pid":1,"tid":0,"ts":0,
+# TRACE: ]}
+
+# RUN: not ld.lld --time-trace-file=%t.dir/nonexistent/x.json %t.o -o %t 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR %s
+# ERR: cannot open time trace file {{.*}}x.json
+
+.globl _start
+_start:
+  call foo
+
+.section .text.foo,"ax"
+foo:
+  ret
@@ -0,0 +1,18 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: echo "FOO { global: foo**; local: *; };" > %t.script
+# RUN: ld.lld --version-script %t.script -shared %t.o -o %t.so
+# RUN: llvm-readobj -dyn-symbols %t.so | FileCheck %s
+
+## Two or more trailing stars match only a non-empty string, as they do
+## for llvm::GlobPattern.
+
+# CHECK-NOT: Name: foo@
+# CHECK:     Name: foo1@@FOO
+# CHECK-NOT: Name: foo@
+
+.globl foo, foo1
+foo:
+foo1:
+  ret